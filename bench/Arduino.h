@@ -0,0 +1,12 @@
+#pragma once
+// Host stand-in for the Arduino core and FreeRTOS: only what the
+// benchmarked sources use. The benchmarks run in one thread, so the
+// mutex is a no-op.
+#include <stdint.h>
+#include <string.h>
+
+typedef void* SemaphoreHandle_t;
+#define portMAX_DELAY  0xFFFFFFFF
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return nullptr; }
+inline int xSemaphoreTake(SemaphoreHandle_t, uint32_t) { return 1; }
+inline int xSemaphoreGive(SemaphoreHandle_t) { return 1; }
@@ -0,0 +1,91 @@
+/**
+ * server_bench.cpp - Host benchmark of the Modbus server core
+ *
+ * Registers the handler ranges the board firmware has always served
+ * (digital inputs, relays, analog, DHT, DS18B20, DAC) with ModbusServer
+ * and times a full-range FC03/FC04 read of each, the same loop as
+ * ModbusServer::benchmark() runs on the board with MODBUS_BENCHMARK.
+ * Handlers copy from a static table, so the figures are the cost of the
+ * request path itself.
+ *
+ *   make -C bench run
+ */
+
+#include <chrono>
+#include <cstdio>
+#include "ModbusServer.h"
+
+#define BENCH_REQUESTS  1000000UL
+#define BENCH_ROUNDS    5
+
+struct Range {
+    const char* name;
+    ModbusRegType type;
+    uint16_t address;
+    uint16_t count;
+};
+
+static const Range ranges[] = {
+    { "digital inputs", MB_INPUT_REG,   MB_REG_INPUTS_START,  NUM_DIGITAL_INPUTS },
+    { "relays",         MB_HOLDING_REG, MB_REG_RELAYS_START,  NUM_RELAY_OUTPUTS },
+    { "analog",         MB_INPUT_REG,   MB_REG_ANALOG_START,  NUM_ANALOG_CHANNELS * 2 },
+    { "temperature",    MB_INPUT_REG,   MB_REG_TEMP_START,    NUM_DHT_SENSORS },
+    { "humidity",       MB_INPUT_REG,   MB_REG_HUM_START,     NUM_DHT_SENSORS },
+    { "DS18B20",        MB_INPUT_REG,   MB_REG_DS18B20_START, MAX_DS18B20_SENSORS },
+    { "DAC",            MB_HOLDING_REG, MB_REG_DAC_START,     4 }
+};
+
+static uint16_t table[MB_SERVER_REG_SPACE];
+
+static uint8_t readTable(void*, ModbusBlock& block) {
+    memcpy(block.values, &table[block.address], block.count * sizeof(uint16_t));
+    return MB_EX_NONE;
+}
+
+int main() {
+    ModbusServer server;
+    for (uint16_t i = 0; i < MB_SERVER_REG_SPACE; i++) {
+        table[i] = i * 7;
+    }
+
+    uint8_t request[5];
+    uint8_t response[MB_MAX_PDU];
+
+    printf("Modbus server turnaround, full-range reads:\n");
+    for (uint8_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+        const Range& range = ranges[r];
+        if (!server.addHandler(range.type, range.address, range.count, cbModbus(readTable, nullptr))) {
+            printf("%s: handler not added\n", range.name);
+            return 1;
+        }
+
+        request[0] = (range.type == MB_HOLDING_REG) ? MB_FC_READ_HOLDING_REGS : MB_FC_READ_INPUT_REGS;
+        request[1] = range.address >> 8;
+        request[2] = range.address & 0xFF;
+        request[3] = range.count >> 8;
+        request[4] = range.count & 0xFF;
+
+        if (server.processPdu(request, sizeof(request), response) != 2 + range.count * 2) {
+            printf("%s: unexpected response\n", range.name);
+            return 1;
+        }
+
+        double best = 0;
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (unsigned long n = 0; n < BENCH_REQUESTS; n++) {
+                server.processPdu(request, sizeof(request), response);
+            }
+            std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+            double perRequest = elapsed.count() / BENCH_REQUESTS;
+            if (best == 0 || perRequest < best) {
+                best = perRequest;
+            }
+        }
+
+        printf("  FC%02X %-15s %3u x%-2u %6.1f ns\n", request[0], range.name, range.address,
+               range.count, best);
+    }
+    return 0;
+}
@@ -1,84 +1,256 @@
-#ifndef CONFIG_H
-#define CONFIG_H
-
-// I2C settings
-#define I2C_SDA_PIN 21
-#define I2C_SCK_PIN 22
-
-// I2C Addresses
-#define MCP23017_INPUT_ADDR   0x21  // U8 MCP23017 (Digital Inputs) - Address 0x21 (Default JP1 Short - 0x21)
-#define MCP23017_OUTPUT_ADDR  0x20  // U26 MCP23017 (Relay Outputs) - Address 0x20 (Default Open Jumpers - 0x20)
-#define GP8413_DAC_ADDR      0x58  // U46 GP8413 DAC Address - Default 0x58
-
-// Digital Input Pins (ESP32)
-#define PIN_RESET_BUTTON     0   // EN pin
-#define PIN_BOOT_ENABLE      0   // GPIO0 - BOOT Enable
-#define PIN_BUZZER           2   // GPIO2 - Buzzer (BEEP)
-
-// MCP23017 Input Interrupt Pins
-#define PIN_MCP_INTA        14   // GPIO14 - U8 MCP23017 PORT A external Interrupt
-#define PIN_MCP_INTB        13   // GPIO13 - U8 MCP23017 PORT B external Interrupt (8 Digital Inputs)
-
-// Analog Input Pins
-#define PIN_ANALOG_CH1      36   // GPIO36 - 0-5V Analog Input Channel 1
-#define PIN_ANALOG_CH2      39   // GPIO39 - 0-5V Analog Input Channel 2
-#define PIN_CURRENT_CH1     34   // GPIO34 - 4-20mA Analog Input Channel 1
-#define PIN_CURRENT_CH2     35   // GPIO35 - 4-20mA Analog Input Channel 2
-
-// DHT22 Temperature/Humidity Sensor Pins
-#define PIN_DHT_SENSOR1      4   // GPIO4 - DHT22 (AM2302) Temperature/Humidity Sensor Input Channel 1
-#define PIN_DHT_SENSOR2     15   // GPIO15 - DHT22 (AM2302) Temperature/Humidity Sensor Input Channel 2
-
-// DS18B20 Temperature Sensor Pin
-#define PIN_DS18B20         12   // GPIO12 - DS18B20 OneWire Temperature Sensors
-
-// RS485 MODBUS Pins
-#define PIN_MAX485_RO       16   // GPIO16 - RS485 MODBUS MAX485 RO pin (RXD)
-#define PIN_MAX485_DI       17   // GPIO17 - RS485 MODBUS MAX485 DI pin (TXD)
-#define PIN_MAX485_TXRX     27   // GPIO27 - MAX485 TXRX Control pin for MODBUS (RS485)
-
-// RF433 Pins
-#define PIN_RF433_TX        32   // GPIO32 - 433MHz RF Transmitter TX
-#define PIN_RF433_RX        33   // GPIO33 - 433MHz RF Receiver RX
-
-// GSM Module Pins
-#define PIN_GSM_TX          25   // GPIO25 - GSM SIM800L/SIM7600E TX
-#define PIN_GSM_RX          26   // GPIO26 - GSM SIM800L/SIM7600E RX
-
-// Ethernet W5500 MODULE SPI Pins
-#define PIN_ETH_CS           5   // GPIO5 - ETHERNET W5500 MODULE SPI Chip Select Pin
-#define PIN_ETH_SCLK        18   // GPIO18 - ETHERNET W5500 MODULE SPI SCLK
-#define PIN_ETH_MISO        19   // GPIO19 - ETHERNET W5500 MODULE SPI MISO
-#define PIN_ETH_MOSI        23   // GPIO23 - ETHERNET W5500 MODULE SPI MOSI
-
-// MCP23017 pins for Ethernet
-#define MCP_ETH_RESET_PORT  MCP23017Port::A  // MCP23017 port used for W5500 reset
-#define MCP_ETH_RESET_PIN   5                // GPA5 pin for W5500 reset
-
-// Ethernet settings
-#define ETH_RESET_DURATION  200    // Reset pulse duration in ms
-#define ETH_INIT_TIMEOUT    10000  // Timeout for Ethernet initialization in ms
-
-// ADC Parameters
-#define ADC_RESOLUTION      4095    // 12-bit ADC
-#define ADC_VOLTAGE_REF     3.3     // Reference voltage in Volts
-#define CURRENT_LOOP_RESISTOR 165.0 // 165 ohm for 4-20mA to voltage conversion
-
-// Constants
-#define NUM_DIGITAL_INPUTS   8
-#define NUM_RELAY_OUTPUTS    6
-#define NUM_ANALOG_CHANNELS  2
-#define NUM_CURRENT_CHANNELS 2
-#define NUM_DHT_SENSORS      2
-#define MAX_DS18B20_SENSORS  8      // Maximum number of DS18B20 sensors
-
-// Modbus register addresses
-#define MB_REG_INPUTS_START     0
-#define MB_REG_RELAYS_START    10
-#define MB_REG_ANALOG_START    20
-#define MB_REG_TEMP_START      30
-#define MB_REG_HUM_START       40
-#define MB_REG_DS18B20_START   50
-#define MB_REG_DAC_START       70
-
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// I2C settings
+#define I2C_SDA_PIN 21
+#define I2C_SCK_PIN 22
+
+// I2C bus manager (I2CBus): one task owns Wire and runs queued transactions
+#define I2C_CLOCK_HZ           400000   // Clock for devices registered without a limit
+#define I2C_CLOCK_STEPS        { 1000000, 400000, 100000 }   // Fallback ladder, fastest first
+#define I2C_TIMEOUT_MS             10   // Wire timeout per transfer
+#define I2C_RETRIES                 2   // Extra attempts after a failed transfer
+#define I2C_FALLBACK_ERRORS         2   // Bus faults in a row before the clock steps down (below I2C_RETRIES + 1)
+#define I2C_RECOVER_SUCCESSES     500   // Clean transfers before it steps up again, doubled per fallback
+#define I2C_RECOVER_MAX         16000   // Cap for the doubled count
+#define I2C_MAX_DEVICES             4   // Devices with their own clock limit and statistics
+#define I2C_HISTOGRAM_BUCKETS       8   // <50, <100, <200, <500, <1000, <2000, <5000, >=5000 us
+#define I2C_QUEUE_SIZE              8   // Transactions that can wait for the bus
+#define I2C_MAX_WRITE              16   // Bytes written per transaction, register address included
+#define I2C_TASK_CORE               1   // Same core as loop(), which waits for most transactions
+#define I2C_TASK_PRIORITY           3   // Above loop() (1), below the Modbus task
+#define I2C_TASK_STACK           3072
+#define I2C_STATS_WINDOW         1000   // Bus utilization measured over this many ms
+
+// I2C Addresses
+#define MCP23017_INPUT_ADDR   0x21  // U8 MCP23017 (Digital Inputs) - Address 0x21 (Default JP1 Short - 0x21)
+#define MCP23017_OUTPUT_ADDR  0x20  // U26 MCP23017 (Relay Outputs) - Address 0x20 (Default Open Jumpers - 0x20)
+#define GP8413_DAC_ADDR      0x58  // U46 GP8413 DAC Address - Default 0x58
+
+// Fastest clock each device allows
+#define MCP23017_MAX_CLOCK_HZ  1000000  // Fast mode plus (1.7 MHz part)
+#define GP8413_MAX_CLOCK_HZ     400000  // Fast mode
+
+// Digital Input Pins (ESP32)
+#define PIN_RESET_BUTTON     0   // EN pin
+#define PIN_BOOT_ENABLE      0   // GPIO0 - BOOT Enable
+#define PIN_BUZZER           2   // GPIO2 - Buzzer (BEEP)
+
+// MCP23017 Input Interrupt Pins
+#define PIN_MCP_INTA        14   // GPIO14 - U8 MCP23017 PORT A external Interrupt
+#define PIN_MCP_INTB        13   // GPIO13 - U8 MCP23017 PORT B external Interrupt (8 Digital Inputs)
+
+// Analog Input Pins
+#define PIN_ANALOG_CH1      36   // GPIO36 - 0-5V Analog Input Channel 1
+#define PIN_ANALOG_CH2      39   // GPIO39 - 0-5V Analog Input Channel 2
+#define PIN_CURRENT_CH1     34   // GPIO34 - 4-20mA Analog Input Channel 1
+#define PIN_CURRENT_CH2     35   // GPIO35 - 4-20mA Analog Input Channel 2
+
+// DHT22 Temperature/Humidity Sensor Pins
+#define PIN_DHT_SENSOR1      4   // GPIO4 - DHT22 (AM2302) Temperature/Humidity Sensor Input Channel 1
+#define PIN_DHT_SENSOR2     15   // GPIO15 - DHT22 (AM2302) Temperature/Humidity Sensor Input Channel 2
+
+// DS18B20 Temperature Sensor Pin
+#define PIN_DS18B20         12   // GPIO12 - DS18B20 OneWire Temperature Sensors
+
+// RS485 MODBUS Pins
+#define PIN_MAX485_RO       16   // GPIO16 - RS485 MODBUS MAX485 RO pin (RXD)
+#define PIN_MAX485_DI       17   // GPIO17 - RS485 MODBUS MAX485 DI pin (TXD)
+#define PIN_MAX485_TXRX     27   // GPIO27 - MAX485 TXRX Control pin for MODBUS (RS485), driven as UART RTS
+
+// RF433 Pins
+#define PIN_RF433_TX        32   // GPIO32 - 433MHz RF Transmitter TX
+#define PIN_RF433_RX        33   // GPIO33 - 433MHz RF Receiver RX
+
+// GSM Module Pins
+#define PIN_GSM_TX          25   // GPIO25 - GSM SIM800L/SIM7600E TX
+#define PIN_GSM_RX          26   // GPIO26 - GSM SIM800L/SIM7600E RX
+
+// Ethernet W5500 MODULE SPI Pins
+#define PIN_ETH_CS           5   // GPIO5 - ETHERNET W5500 MODULE SPI Chip Select Pin
+#define PIN_ETH_SCLK        18   // GPIO18 - ETHERNET W5500 MODULE SPI SCLK
+#define PIN_ETH_MISO        19   // GPIO19 - ETHERNET W5500 MODULE SPI MISO
+#define PIN_ETH_MOSI        23   // GPIO23 - ETHERNET W5500 MODULE SPI MOSI
+
+// MCP23017 pins for Ethernet
+#define MCP_ETH_RESET_PORT  MCP_PORT_A       // MCP23017 port used for W5500 reset
+#define MCP_ETH_RESET_PIN   5                // GPA5 pin for W5500 reset
+
+// Ethernet settings
+#define ETH_RESET_DURATION  200    // Reset pulse duration in ms
+#define ETH_INIT_TIMEOUT    10000  // Timeout for Ethernet initialization in ms
+
+// ADC Parameters
+#define ADC_RESOLUTION      4095    // 12-bit ADC
+#define ADC_VOLTAGE_REF     3.3     // Reference voltage in Volts
+#define CURRENT_LOOP_RESISTOR 165.0 // 165 ohm for 4-20mA to voltage conversion
+
+// Constants
+#define NUM_DIGITAL_INPUTS   8
+#define NUM_RELAY_OUTPUTS    6
+#define NUM_ANALOG_CHANNELS  2
+#define NUM_CURRENT_CHANNELS 2
+#define NUM_DHT_SENSORS      2
+#define MAX_DS18B20_SENSORS  8      // Maximum number of DS18B20 sensors
+
+// Relay switching
+#define RELAY_INRUSH_GAP_MS        20   // Gap between relays switched on together, 0 = all at once
+
+// Process image
+#define PROCESS_IMAGE_INTERVAL      50   // Acquisition period in ms
+#define PROCESS_IMAGE_WRITE_QUEUE   16   // Output writes waiting to be applied
+
+// Modbus register addresses
+#define MB_REG_INPUTS_START     0
+#define MB_COIL_RELAYS_START    0     // Relays as coils (FC01/05/15)
+#define MB_DISCRETE_INPUTS_START 0    // Digital inputs as discrete inputs (FC02)
+#define MB_REG_RELAYS_START    10
+#define MB_REG_ANALOG_START    20
+#define MB_REG_TEMP_START      30
+#define MB_REG_HUM_START       40
+#define MB_REG_DS18B20_START   50
+#define MB_REG_DAC_START       70
+
+// Packed whole-board window (input registers, read-only). Mirrors every
+// live value contiguously so one FC04 request returns the board state.
+#define MB_REG_BOARD_START     100   // Base address of the window
+#define MB_BOARD_STATUS          0   // Status bits (MB_BOARD_STATUS_*)
+#define MB_BOARD_QUALITY         1   // Bit 0-1 DHT22 valid, bit 8-15 DS18B20 valid
+#define MB_BOARD_SEQUENCE        2   // Process image sequence (low 16 bits)
+#define MB_BOARD_AGE             3   // Snapshot age in ms (saturates at 65535)
+#define MB_BOARD_INPUTS          4   // Digital input bits
+#define MB_BOARD_RELAYS          5   // Relay state bits
+#define MB_BOARD_ANALOG          6   // 2x voltage (mV), 2x current (uA)
+#define MB_BOARD_TEMP           10   // 2x DHT22 temperature (0.1 degC, signed)
+#define MB_BOARD_HUM            12   // 2x DHT22 humidity (0.1 %RH)
+#define MB_BOARD_DS18B20_COUNT  14   // Number of DS18B20 sensors found
+#define MB_BOARD_DS18B20        15   // 8x DS18B20 temperature (0.1 degC, signed)
+#define MB_BOARD_DAC            23   // Per channel: voltage (mV), current (uA)
+#define MB_BOARD_CHANGES        27   // Incremented when any value above except sequence/age changes
+#define MB_BOARD_WINDOW_SIZE    28
+
+#define MB_BOARD_STATUS_FRESH    0x0001  // Snapshot younger than 2 acquisition periods
+#define MB_BOARD_STATUS_DS18B20  0x0002  // At least one DS18B20 found
+#define MB_BOARD_STATUS_PENDING  0x0004  // Output writes waiting to be applied
+
+#define MB_BOARD_ANALOG_DEADBAND    25   // mV/uA an analog input must move before the window shows it
+
+// 32-bit register views (input registers, two per value). Both registers
+// of a value always come from the same sample. Layout of each view:
+// 2x voltage, 2x current, 2x DHT22 temperature, 2x DHT22 humidity,
+// 8x DS18B20 temperature, 2x DAC voltage, 2x DAC current
+#define MB_32BIT_VIEWS                  // Serve the views below
+#define MB_REG_FLOAT_START     400   // float32 in V, mA, degC, %RH (NaN = no sensor)
+#define MB_REG_INT32_START     500   // int32 in mV, uA, m degC, m %RH (0x80000000 = no sensor)
+// #define MB_WORD_LOW_FIRST            // Low word first (CDAB) instead of high word first (ABCD)
+
+#define MB_VIEW_VOLTAGE          0
+#define MB_VIEW_CURRENT         (MB_VIEW_VOLTAGE + 2 * NUM_ANALOG_CHANNELS)
+#define MB_VIEW_TEMP            (MB_VIEW_CURRENT + 2 * NUM_CURRENT_CHANNELS)
+#define MB_VIEW_HUM             (MB_VIEW_TEMP + 2 * NUM_DHT_SENSORS)
+#define MB_VIEW_DS18B20         (MB_VIEW_HUM + 2 * NUM_DHT_SENSORS)
+#define MB_VIEW_DAC_VOLTAGE     (MB_VIEW_DS18B20 + 2 * MAX_DS18B20_SENSORS)
+#define MB_VIEW_DAC_CURRENT     (MB_VIEW_DAC_VOLTAGE + 2 * 2)
+#define MB_VIEW_SIZE            (MB_VIEW_DAC_CURRENT + 2 * 2)
+
+// Sensor history and event log, served as FC20/21 file records
+#define HISTORY_INTERVAL        60000   // ms between history samples
+#define HISTORY_DEPTH             512   // Samples kept (oldest overwritten)
+#define EVENT_LOG_DEPTH           256   // Events kept (oldest overwritten)
+#define MB_FILE_HISTORY             1   // File number of the sample history
+#define MB_FILE_EVENTS              2   // File number of the event log
+
+// Modbus server settings
+#define MB_SERVER_ID                1   // RTU slave address of this board
+#define MB_SERVER_MAX_HANDLERS     32   // Registered handler ranges
+#define MB_SERVER_REG_SPACE      1024   // Holding/input register addresses 0..N-1
+#define MB_SERVER_BIT_SPACE       256   // Coil/discrete input addresses 0..N-1
+#define MB_SERVER_MAX_VALUES      256   // Values per request (>= 125 and >= MB_SERVER_BIT_SPACE)
+#define MB_SERVER_MAX_FILES         4   // Registered FC20/21 files
+// #define MODBUS_BENCHMARK             // Print server turnaround at startup and RTU latency with the status
+
+// Modbus TCP server settings
+#define MB_TCP_PORT               502
+#define MB_TCP_MAX_CLIENTS          4   // W5500 has 8 sockets, the rest stay free for DHCP and others
+#define MB_TCP_MAX_ADU            260   // MBAP header + largest PDU
+#define MB_TCP_PIPELINE             4   // Requests answered per connection and pass
+#define MB_TCP_IDLE_TIMEOUT     60000   // Close connections idle for this long (ms)
+
+// Aggregator: poll other A8R-M boards on RS485 and republish their board
+// windows as local input registers (served over Modbus TCP). Board k of
+// MB_AGG_BOARDS appears at MB_AGG_REG_START + k * MB_AGG_STRIDE:
+//   +0 link status (MB_AGG_LINK_*), +1 age of the copy in ms (saturates),
+//   +2 slave address, +3 full window transfers, +4.. the board window
+// #define MB_AGGREGATOR_MODE           // RS485 is a master polling the boards below
+#define MB_AGG_BOARDS          { 2, 3 }  // Slave addresses of the polled boards
+#define MB_AGG_MAX_BOARDS           8   // Boards the register layout has room for
+#define MB_AGG_POLL_PERIOD         50   // ms between change counter reads of one board
+#define MB_AGG_REFRESH_PERIOD    5000   // Read the whole window at least this often (ms)
+#define MB_AGG_REG_START          600
+#define MB_AGG_STRIDE              32
+#define MB_AGG_HEADER               4   // Registers before the window copy
+
+#define MB_AGG_LINK_ONLINE     0x0001  // Last request to the board was answered
+#define MB_AGG_LINK_VALID      0x0002  // Window copy present
+
+// Modbus TCP-to-RTU gateway
+// #define MB_GATEWAY_MODE              // RS485 is a master, TCP requests for other unit IDs are forwarded
+#define MB_GW_QUEUE_DEPTH           4   // Forwarded requests queued per TCP connection
+#define MB_GW_RESPONSE_TIMEOUT    500   // RTU reply timeout in ms
+#define MB_GW_QUEUE_TIMEOUT      2000   // Longest wait for the bus before answering 0x0B (ms)
+
+// Modbus RTU settings
+#define MB_RTU_MAX_FRAME          256   // Largest RTU frame (address + PDU + CRC)
+#define MB_RTU_RX_BUFFER          512   // UART driver receive ring buffer
+#define MB_RTU_RX_TIMEOUT_SYMBOLS   3   // Idle characters that end a frame (between t1.5 and t3.5)
+#define MB_CRC_METHOD   MB_CRC_TABLE   // MB_CRC_BITWISE, MB_CRC_TABLE or MB_CRC_SLICING4 (see ModbusFrame.h)
+#define MB_MASTER_QUEUE_SIZE        8   // Requests that can wait for the bus
+#define MB_MASTER_DEFAULT_TIMEOUT 1000  // Reply timeout in ms before a slave's latency is known (and the upper limit)
+#define MB_MASTER_MIN_TIMEOUT       20  // Lower limit of the adaptive reply timeout in ms
+#define MB_MASTER_RETRIES            2  // Extra attempts after a timeout or a garbled reply
+#define MB_MASTER_RETRY_BACKOFF     20  // Wait before the first retry in ms, doubled for each further one
+#define MB_MASTER_OFFLINE_AFTER      3  // Failed requests in a row before a slave is marked offline
+#define MB_MASTER_PROBE_INTERVAL  5000  // ms between probe requests to an offline slave
+#define MB_MASTER_MAX_SLAVES        16  // Slaves with adaptive timing
+#define MB_MASTER_TURNAROUND_DELAY 100  // Wait after a broadcast write in ms
+
+// Modbus diagnostics window (input registers): FC08 counters 0x0B..0x12,
+// then per RS485 slave: id, requests, successes, exceptions, timeouts,
+// CRC errors, invalid replies, max round trip (ms), round-trip histogram
+#define MB_REG_DIAG_START         200
+#define MB_DIAG_SERVER_REGS         8
+#define MB_DIAG_MAX_SLAVES          8   // Slaves with master statistics
+#define MB_DIAG_HISTOGRAM_BUCKETS   8   // <5, <10, <20, <50, <100, <200, <500, >=500 ms
+#define MB_DIAG_SLAVE_REGS         16
+#define MB_DIAG_WINDOW_SIZE       (MB_DIAG_SERVER_REGS + MB_DIAG_MAX_SLAVES * MB_DIAG_SLAVE_REGS)
+
+// I2C statistics window (input registers): clock limit (kHz), utilization
+// (%), fallbacks, recoveries, then per device: address, transactions,
+// failures, NACKs, timeouts, retries, bytes, max latency (us), latency
+// histogram
+#define MB_REG_I2C_START          900
+#define MB_I2C_BUS_REGS             4
+#define MB_I2C_DEVICE_REGS         16
+#define MB_I2C_WINDOW_SIZE        (MB_I2C_BUS_REGS + I2C_MAX_DEVICES * MB_I2C_DEVICE_REGS)
+
+// Modbus RTU task
+#define MB_RTU_TASK                     // Run the RS485 port in its own task instead of loop() (not in gateway mode)
+#define MB_TASK_CORE                0   // loop() runs on core 1
+#define MB_TASK_PRIORITY            5   // Above loop() (1)
+#define MB_TASK_STACK            4096
+
+// Modbus master poll table
+#define MB_POLL_MAX_ITEMS          16   // Declared poll items
+#define MB_POLL_CACHE_SIZE        512   // Cached registers/bits over all poll blocks
+#define MB_POLL_STALE_FACTOR        3   // Results older than this many periods are stale
+#define MB_PROFILE_MAX_POINTS      32   // Data points per device profile (see DeviceProfiles.h)
+
+// RS485 discovery scan (ModbusScanner)
+#define MB_SCAN_BAUD_RATES  { 9600, 19200, 115200, 38400, 57600, 4800, 2400 }  // Most common first
+#define MB_SCAN_QUICK_IDS          16   // IDs 1..n probed at every baud rate, the rest only where something answered
+#define MB_SCAN_TIMEOUT            50   // Longest reply latency waited for in ms (until a slave has answered)
+#define MB_SCAN_MIN_TIMEOUT        10   // Lower limit of the latency budget once slaves have answered (ms)
+#define MB_SCAN_LATENCY_FACTOR      4   // Budget = this times the slowest latency seen
+#define MB_SCAN_MAX_DEVICES        16   // Entries in the device table
+
 #endif // CONFIG_H
\ No newline at end of file
@@ -1,89 +1,110 @@
-#include "DACControl.h"
-
-DACControl::DACControl() {
-    currentVoltages[0] = 0.0;
-    currentVoltages[1] = 0.0;
-    currentCurrents[0] = 4.0;  // 4mA is minimum for current loop
-    currentCurrents[1] = 4.0;
-}
-
-bool DACControl::begin() {
-    // Initialize the I2C connection
-    Wire.begin();
-
-    // Initialize the DAC without specifying the address
-    // (The GP8413 library uses the default address internally)
-    dac.begin();
-
-    // Since there's no setI2CAddress method, we'll directly configure the DAC
-    // via the Wire library to set the configuration
-    Wire.beginTransmission(GP8413_DAC_ADDR);
-    Wire.write(0x02);  // Configuration register
-    Wire.write(0x01);  // Enable DAC
-    Wire.endTransmission();
-
-    // Reset outputs to zero
-    dac.setDACOutVoltage(0, 0.0);
-    dac.setDACOutVoltage(1, 0.0);
-
-    return true;
-}
-
-bool DACControl::setVoltage(uint8_t channel, float voltage) {
-    if (channel > 1) {  // GP8413 has 2 channels (0 and 1)
-        return false;
-    }
-
-    // Constrain voltage to 0-5V range
-    voltage = constrain(voltage, 0.0, 5.0);
-
-    // Set DAC output
-    dac.setDACOutVoltage(channel, voltage);
-
-    // Store current voltage
-    currentVoltages[channel] = voltage;
-
-    // Update current value if channel is used for current loop
-    if (voltage <= 3.3) {  // Max voltage for 20mA (assuming 165 ohm resistor)
-        float current = 4.0 + (voltage / 3.3) * 16.0;  // Scale to 4-20mA
-        currentCurrents[channel] = current;
-    }
-
-    return true;
-}
-
-bool DACControl::setCurrent(uint8_t channel, float currentmA) {
-    if (channel > 1) {  // GP8413 has 2 channels (0 and 1)
-        return false;
-    }
-
-    // Constrain current to 4-20mA range
-    currentmA = constrain(currentmA, 4.0, 20.0);
-
-    // Calculate voltage needed for this current (V = I * R)
-    // For 4-20mA with 165 ohm resistor, voltage range is ~0.66V to ~3.3V
-    float voltage = (currentmA - 4.0) * (3.3 / 16.0);
-
-    // Set DAC output
-    dac.setDACOutVoltage(channel, voltage);
-
-    // Store current values
-    currentVoltages[channel] = voltage;
-    currentCurrents[channel] = currentmA;
-
-    return true;
-}
-
-float DACControl::getVoltage(uint8_t channel) {
-    if (channel > 1) {
-        return 0.0;
-    }
-    return currentVoltages[channel];
-}
-
-float DACControl::getCurrent(uint8_t channel) {
-    if (channel > 1) {
-        return 4.0;  // Minimum current loop value
-    }
-    return currentCurrents[channel];
+#include "DACControl.h"
+
+DACControl::DACControl() : bus(nullptr) {
+    currentVoltages[0] = 0.0;
+    currentVoltages[1] = 0.0;
+    currentCurrents[0] = 4.0;  // 4mA is minimum for current loop
+    currentCurrents[1] = 4.0;
+}
+
+bool DACControl::begin(I2CBus& i2c) {
+    // The bus manager has already started Wire
+    bus = &i2c;
+    bus->addDevice(GP8413_DAC_ADDR, GP8413_MAX_CLOCK_HZ);
+
+    // The setup drives Wire directly, so it runs as a job at the DAC's clock
+    bus->run(runSetup, &dac, I2C_PRIO_NORMAL, GP8413_DAC_ADDR);
+
+    return true;
+}
+
+bool DACControl::runSetup(TwoWire& wire, void* context) {
+    DFRobot_GP8413* dac = static_cast<DFRobot_GP8413*>(context);
+
+    // Initialize the DAC without specifying the address
+    // (The GP8413 library uses the default address internally)
+    dac->begin();
+
+    // Since there's no setI2CAddress method, we'll directly configure the DAC
+    // via the Wire library to set the configuration
+    wire.beginTransmission(GP8413_DAC_ADDR);
+    wire.write(0x02);  // Configuration register
+    wire.write(0x01);  // Enable DAC
+    wire.endTransmission();
+
+    // Reset outputs to zero
+    dac->setDACOutVoltage(0, 0.0);
+    dac->setDACOutVoltage(1, 0.0);
+
+    return true;
+}
+
+bool DACControl::setVoltage(uint8_t channel, float voltage) {
+    if (channel > 1) {  // GP8413 has 2 channels (0 and 1)
+        return false;
+    }
+
+    // Constrain voltage to 0-5V range
+    voltage = constrain(voltage, 0.0, 5.0);
+
+    // Set DAC output
+    writeOutput(channel, voltage);
+
+    // Store current voltage
+    currentVoltages[channel] = voltage;
+
+    // Update current value if channel is used for current loop
+    if (voltage <= 3.3) {  // Max voltage for 20mA (assuming 165 ohm resistor)
+        float current = 4.0 + (voltage / 3.3) * 16.0;  // Scale to 4-20mA
+        currentCurrents[channel] = current;
+    }
+
+    return true;
+}
+
+bool DACControl::setCurrent(uint8_t channel, float currentmA) {
+    if (channel > 1) {  // GP8413 has 2 channels (0 and 1)
+        return false;
+    }
+
+    // Constrain current to 4-20mA range
+    currentmA = constrain(currentmA, 4.0, 20.0);
+
+    // Calculate voltage needed for this current (V = I * R)
+    // For 4-20mA with 165 ohm resistor, voltage range is ~0.66V to ~3.3V
+    float voltage = (currentmA - 4.0) * (3.3 / 16.0);
+
+    // Set DAC output
+    writeOutput(channel, voltage);
+
+    // Store current values
+    currentVoltages[channel] = voltage;
+    currentCurrents[channel] = currentmA;
+
+    return true;
+}
+
+bool DACControl::writeOutput(uint8_t channel, float voltage) {
+    OutputWrite write = { &dac, channel, voltage };
+    return bus->run(runOutputWrite, &write, I2C_PRIO_NORMAL, GP8413_DAC_ADDR);
+}
+
+bool DACControl::runOutputWrite(TwoWire& wire, void* context) {
+    OutputWrite* write = static_cast<OutputWrite*>(context);
+    write->dac->setDACOutVoltage(write->channel, write->voltage);
+    return true;
+}
+
+float DACControl::getVoltage(uint8_t channel) {
+    if (channel > 1) {
+        return 0.0;
+    }
+    return currentVoltages[channel];
+}
+
+float DACControl::getCurrent(uint8_t channel) {
+    if (channel > 1) {
+        return 4.0;  // Minimum current loop value
+    }
+    return currentCurrents[channel];
 }
\ No newline at end of file
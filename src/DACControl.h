@@ -1,29 +1,42 @@
-#ifndef DAC_CONTROL_H
-#define DAC_CONTROL_H
-
-#include <Arduino.h>
-#include <DFRobot_GP8XXX.h>
-#include "Config.h"
-
-class DACControl {
-public:
-    DACControl();
-    bool begin();
-    
-    // Set output voltage for a channel (0-5V)
-    bool setVoltage(uint8_t channel, float voltage);
-    
-    // Set output current for a channel (4-20mA)
-    bool setCurrent(uint8_t channel, float currentmA);
-    
-    // Get currently set values
-    float getVoltage(uint8_t channel);
-    float getCurrent(uint8_t channel);
-
-private:
-    DFRobot_GP8413 dac;
-    float currentVoltages[2];
-    float currentCurrents[2];
-};
-
+#ifndef DAC_CONTROL_H
+#define DAC_CONTROL_H
+
+#include <Arduino.h>
+#include <DFRobot_GP8XXX.h>
+#include "Config.h"
+#include "I2CBus.h"
+
+class DACControl {
+public:
+    DACControl();
+    bool begin(I2CBus& bus);
+    
+    // Set output voltage for a channel (0-5V)
+    bool setVoltage(uint8_t channel, float voltage);
+    
+    // Set output current for a channel (4-20mA)
+    bool setCurrent(uint8_t channel, float currentmA);
+    
+    // Get currently set values
+    float getVoltage(uint8_t channel);
+    float getCurrent(uint8_t channel);
+
+private:
+    // Output write run on the I2C bus task (the library drives Wire itself)
+    struct OutputWrite {
+        DFRobot_GP8413* dac;
+        uint8_t channel;
+        float voltage;
+    };
+
+    I2CBus* bus;
+    DFRobot_GP8413 dac;
+    float currentVoltages[2];
+    float currentCurrents[2];
+
+    bool writeOutput(uint8_t channel, float voltage);
+    static bool runSetup(TwoWire& wire, void* context);
+    static bool runOutputWrite(TwoWire& wire, void* context);
+};
+
 #endif // DAC_CONTROL_H
\ No newline at end of file
@@ -0,0 +1,142 @@
+/**
+ * DeviceProfiles.h - Downstream Modbus device profiles for Cortex Link A8R-M ESP32 IoT Smart Home Controller
+ *
+ * A profile describes one slave type as constexpr tables: its data points
+ * (function, address, encoding, scale), the largest read it accepts and
+ * the address ranges it answers with an exception. ModbusDevice turns a
+ * profile into the fewest block reads for ModbusPoller; a block may span
+ * unused registers but never a gap. Every profile is checked at compile
+ * time: points sorted by function and address without overlaps, no point
+ * wider than the read limit and no point inside a gap.
+ *
+ * To add a device, write its point and gap tables, a DeviceProfile and a
+ * static_assert like the ones below.
+ */
+
+#ifndef DEVICE_PROFILES_H
+#define DEVICE_PROFILES_H
+
+#include <Arduino.h>
+#include "ModbusDefs.h"
+
+// Register encoding of a data point
+enum ProfileEncoding {
+    PE_U16,
+    PE_S16,
+    PE_U32,
+    PE_S32,
+    PE_FLOAT32,
+    PE_BIT                   // Coil or discrete input
+};
+
+struct ProfilePoint {
+    const char* name;
+    const char* unit;
+    uint8_t function;        // MB_FC_READ_*
+    uint16_t address;
+    ProfileEncoding encoding;
+    float scale;             // Engineering value = raw * scale
+};
+
+// Addresses of one function the device rejects
+struct ProfileGap {
+    uint8_t function;
+    uint16_t start;
+    uint16_t count;
+};
+
+struct DeviceProfile {
+    const char* name;
+    const ProfilePoint* points;
+    uint8_t pointCount;
+    const ProfileGap* gaps;
+    uint8_t gapCount;
+    uint16_t maxPerRead;     // Registers (or bits) per request
+    bool lowWordFirst;       // 32-bit values low word first (CDAB)
+};
+
+namespace ProfileCheck {
+    constexpr uint16_t width(const ProfilePoint& p) {
+        return (p.encoding == PE_U32 || p.encoding == PE_S32 || p.encoding == PE_FLOAT32) ? 2 : 1;
+    }
+
+    constexpr bool inGap(const ProfilePoint& p, const ProfileGap* gaps, uint8_t count) {
+        return count > 0 &&
+               ((gaps[0].function == p.function &&
+                 p.address < gaps[0].start + gaps[0].count && gaps[0].start < p.address + width(p)) ||
+                inGap(p, gaps + 1, count - 1));
+    }
+
+    constexpr bool ordered(const ProfilePoint& a, const ProfilePoint& b) {
+        return a.function < b.function || (a.function == b.function && a.address + width(a) <= b.address);
+    }
+
+    constexpr bool pointsValid(const DeviceProfile& d, uint8_t i) {
+        return i >= d.pointCount ||
+               (width(d.points[i]) <= d.maxPerRead &&
+                !inGap(d.points[i], d.gaps, d.gapCount) &&
+                (i == 0 || ordered(d.points[i - 1], d.points[i])) &&
+                pointsValid(d, i + 1));
+    }
+
+    constexpr bool valid(const DeviceProfile& d) {
+        return d.pointCount > 0 && d.maxPerRead > 0 && pointsValid(d, 0);
+    }
+}
+
+// Eastron SDM120 single phase energy meter (input registers, float32)
+constexpr ProfilePoint sdm120Points[] = {
+    { "voltage",         "V",    MB_FC_READ_INPUT_REGS, 0x0000, PE_FLOAT32, 1 },
+    { "current",         "A",    MB_FC_READ_INPUT_REGS, 0x0006, PE_FLOAT32, 1 },
+    { "active_power",    "W",    MB_FC_READ_INPUT_REGS, 0x000C, PE_FLOAT32, 1 },
+    { "apparent_power",  "VA",   MB_FC_READ_INPUT_REGS, 0x0012, PE_FLOAT32, 1 },
+    { "reactive_power",  "var",  MB_FC_READ_INPUT_REGS, 0x0018, PE_FLOAT32, 1 },
+    { "power_factor",    "",     MB_FC_READ_INPUT_REGS, 0x001E, PE_FLOAT32, 1 },
+    { "frequency",       "Hz",   MB_FC_READ_INPUT_REGS, 0x0046, PE_FLOAT32, 1 },
+    { "import_energy",   "kWh",  MB_FC_READ_INPUT_REGS, 0x0048, PE_FLOAT32, 1 },
+    { "export_energy",   "kWh",  MB_FC_READ_INPUT_REGS, 0x004A, PE_FLOAT32, 1 },
+    { "total_energy",    "kWh",  MB_FC_READ_INPUT_REGS, 0x0156, PE_FLOAT32, 1 },
+};
+
+constexpr ProfileGap sdm120Gaps[] = {
+    { MB_FC_READ_INPUT_REGS, 0x0020, 0x0046 - 0x0020 },
+    { MB_FC_READ_INPUT_REGS, 0x004C, 0x0156 - 0x004C },
+};
+
+constexpr DeviceProfile profileSdm120 = {
+    "SDM120", sdm120Points, sizeof(sdm120Points) / sizeof(sdm120Points[0]),
+    sdm120Gaps, sizeof(sdm120Gaps) / sizeof(sdm120Gaps[0]), 80, false
+};
+
+// Delta MS300/VFD-E drive status monitor (holding registers)
+constexpr ProfilePoint deltaVfdPoints[] = {
+    { "error_code",      "",     MB_FC_READ_HOLDING_REGS, 0x2100, PE_U16, 1 },
+    { "status",          "",     MB_FC_READ_HOLDING_REGS, 0x2101, PE_U16, 1 },
+    { "frequency_cmd",   "Hz",   MB_FC_READ_HOLDING_REGS, 0x2102, PE_U16, 0.01 },
+    { "output_freq",     "Hz",   MB_FC_READ_HOLDING_REGS, 0x2103, PE_U16, 0.01 },
+    { "output_current",  "A",    MB_FC_READ_HOLDING_REGS, 0x2104, PE_U16, 0.01 },
+    { "dc_bus_voltage",  "V",    MB_FC_READ_HOLDING_REGS, 0x2105, PE_U16, 0.1 },
+    { "output_voltage",  "V",    MB_FC_READ_HOLDING_REGS, 0x2106, PE_U16, 0.1 },
+};
+
+constexpr DeviceProfile profileDeltaVfd = {
+    "Delta VFD", deltaVfdPoints, sizeof(deltaVfdPoints) / sizeof(deltaVfdPoints[0]),
+    nullptr, 0, 20, false
+};
+
+// XY-MD02 temperature/humidity transmitter (input registers)
+constexpr ProfilePoint xyMd02Points[] = {
+    { "temperature",     "degC", MB_FC_READ_INPUT_REGS, 0x0001, PE_S16, 0.1 },
+    { "humidity",        "%RH",  MB_FC_READ_INPUT_REGS, 0x0002, PE_U16, 0.1 },
+};
+
+constexpr DeviceProfile profileXyMd02 = {
+    "XY-MD02", xyMd02Points, sizeof(xyMd02Points) / sizeof(xyMd02Points[0]),
+    nullptr, 0, 2, false
+};
+
+static_assert(ProfileCheck::valid(profileSdm120), "SDM120 profile invalid");
+static_assert(ProfileCheck::valid(profileDeltaVfd), "Delta VFD profile invalid");
+static_assert(ProfileCheck::valid(profileXyMd02), "XY-MD02 profile invalid");
+
+#endif // DEVICE_PROFILES_H
@@ -0,0 +1,200 @@
+/**
+ * HistoryLog.cpp - Implementation of the sensor history and event log
+ */
+
+#include "HistoryLog.h"
+#include <esp_timer.h>
+
+// Value * scale as a record, 'missing' if the sensor has no reading
+static inline uint16_t toRecord(float value, uint16_t scale, bool valid, uint16_t missing) {
+    return valid ? (uint16_t)(int32_t)(value * scale) : missing;
+}
+
+HistoryLog::HistoryLog() :
+    image(nullptr),
+    lastSample(0),
+    lastSequence(0),
+    lastInputs(0),
+    lastRelays(0),
+    lastDhtConnected(0),
+    lastDs18b20Count(0)
+{
+    memset(samples, 0, sizeof(samples));
+    memset(events, 0, sizeof(events));
+
+    history.slots = samples;
+    history.depth = HISTORY_DEPTH;
+    history.entryRegs = HISTORY_SAMPLE_REGS;
+    history.next = 0;
+    history.count = 0;
+
+    eventLog.slots = events;
+    eventLog.depth = EVENT_LOG_DEPTH;
+    eventLog.entryRegs = HISTORY_EVENT_REGS;
+    eventLog.next = 0;
+    eventLog.count = 0;
+}
+
+bool HistoryLog::begin(ModbusComm& comm, ProcessImage& processImage) {
+    image = &processImage;
+
+    const ProcessImageData& data = image->snapshot();
+    remember(data);
+    logEvent(HIST_EVENT_BOOT, 0, 0);
+    takeSample(data);
+    lastSample = millis();
+
+    cbModbusFile cb = cbModbusFile::bind<HistoryLog, &HistoryLog::handleFiles>(this);
+    bool ok = comm.addFileHandler(MB_FILE_HISTORY, cb);
+    ok &= comm.addFileHandler(MB_FILE_EVENTS, cb);
+    return ok;
+}
+
+void HistoryLog::task() {
+    if (image == nullptr) {
+        return;
+    }
+
+    const ProcessImageData& data = image->snapshot();
+    if (data.sequence != lastSequence) {
+        detectEvents(data);
+        remember(data);
+    }
+
+    if (millis() - lastSample >= HISTORY_INTERVAL) {
+        lastSample += HISTORY_INTERVAL;
+        takeSample(data);
+    }
+}
+
+void HistoryLog::logEvent(HistoryEvent type, uint8_t index, uint16_t value) {
+    uint32_t now = uptime();
+    uint16_t entry[HISTORY_EVENT_REGS] = {
+        (uint16_t)(now >> 16),
+        (uint16_t)(now & 0xFFFF),
+        (uint16_t)((type << 8) | index),
+        value
+    };
+    append(eventLog, entry);
+}
+
+void HistoryLog::takeSample(const ProcessImageData& data) {
+    uint16_t entry[HISTORY_SAMPLE_REGS];
+    uint16_t* r = entry;
+
+    uint32_t now = uptime();
+    *r++ = now >> 16;
+    *r++ = now & 0xFFFF;
+    for (uint8_t i = 0; i < NUM_ANALOG_CHANNELS; i++) {
+        *r++ = toRecord(data.voltages[i], 1000, true, 0);
+    }
+    for (uint8_t i = 0; i < NUM_CURRENT_CHANNELS; i++) {
+        *r++ = toRecord(data.currents[i], 1000, true, 0);
+    }
+    for (uint8_t i = 0; i < NUM_DHT_SENSORS; i++) {
+        *r++ = toRecord(data.temperatures[i], 10, data.dhtConnected & (1 << i), 0x8000);
+    }
+    for (uint8_t i = 0; i < NUM_DHT_SENSORS; i++) {
+        *r++ = toRecord(data.humidities[i], 10, data.dhtConnected & (1 << i), 0xFFFF);
+    }
+    *r++ = data.inputs | (data.relays << 8);
+    *r++ = toRecord(data.ds18b20Temps[0], 10, data.ds18b20Count > 0 && data.ds18b20Temps[0] > -127.0, 0x8000);
+
+    append(history, entry);
+}
+
+void HistoryLog::detectEvents(const ProcessImageData& data) {
+    uint8_t changed = data.inputs ^ lastInputs;
+    for (uint8_t i = 0; i < NUM_DIGITAL_INPUTS; i++) {
+        if (changed & (1 << i)) {
+            logEvent(HIST_EVENT_INPUT, i, (data.inputs >> i) & 0x01);
+        }
+    }
+
+    changed = data.relays ^ lastRelays;
+    for (uint8_t i = 0; i < NUM_RELAY_OUTPUTS; i++) {
+        if (changed & (1 << i)) {
+            logEvent(HIST_EVENT_RELAY, i, (data.relays >> i) & 0x01);
+        }
+    }
+
+    changed = data.dhtConnected ^ lastDhtConnected;
+    for (uint8_t i = 0; i < NUM_DHT_SENSORS; i++) {
+        if (changed & (1 << i)) {
+            logEvent(HIST_EVENT_DHT, i, (data.dhtConnected >> i) & 0x01);
+        }
+    }
+
+    if (data.ds18b20Count != lastDs18b20Count) {
+        logEvent(HIST_EVENT_DS18B20, 0, data.ds18b20Count);
+    }
+}
+
+void HistoryLog::remember(const ProcessImageData& data) {
+    lastSequence = data.sequence;
+    lastInputs = data.inputs;
+    lastRelays = data.relays;
+    lastDhtConnected = data.dhtConnected;
+    lastDs18b20Count = data.ds18b20Count;
+}
+
+void HistoryLog::append(Ring& ring, const uint16_t* entry) {
+    portENTER_CRITICAL(&lock);
+    memcpy(&ring.slots[ring.next * ring.entryRegs], entry, ring.entryRegs * sizeof(uint16_t));
+    ring.next = (ring.next + 1) % ring.depth;
+    if (ring.count < ring.depth) {
+        ring.count++;
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+// Runs in the Modbus server, possibly on the RTU task
+uint8_t HistoryLog::handleFiles(ModbusFileBlock& block) {
+    return handleFile((block.file == MB_FILE_HISTORY) ? history : eventLog, block);
+}
+
+uint8_t HistoryLog::handleFile(Ring& ring, ModbusFileBlock& block) {
+    uint32_t size = HISTORY_HEADER_REGS + (uint32_t)ring.depth * ring.entryRegs;
+    if ((uint32_t)block.record + block.count > size) {
+        return MB_EX_ILLEGAL_ADDRESS;
+    }
+
+    if (block.write) {
+        // Only "entries held = 0" is writable
+        if (block.record != 0 || block.count != 1) {
+            return MB_EX_ILLEGAL_ADDRESS;
+        }
+        if (block.values[0] != 0) {
+            return MB_EX_ILLEGAL_VALUE;
+        }
+
+        portENTER_CRITICAL(&lock);
+        memset(ring.slots, 0, (uint32_t)ring.depth * ring.entryRegs * sizeof(uint16_t));
+        ring.next = 0;
+        ring.count = 0;
+        portEXIT_CRITICAL(&lock);
+
+        logEvent(HIST_EVENT_CLEARED, block.file, 0);
+        return MB_EX_NONE;
+    }
+
+    portENTER_CRITICAL(&lock);
+    for (uint16_t i = 0; i < block.count; i++) {
+        uint16_t record = block.record + i;
+        switch (record) {
+            case 0:  block.values[i] = ring.count; break;
+            case 1:  block.values[i] = ring.entryRegs; break;
+            case 2:  block.values[i] = ring.next; break;
+            case 3:  block.values[i] = ring.depth; break;
+            default: block.values[i] = ring.slots[record - HISTORY_HEADER_REGS]; break;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+
+    return MB_EX_NONE;
+}
+
+uint32_t HistoryLog::uptime() {
+    // esp_timer does not wrap like millis() does after 49 days
+    return (uint32_t)(esp_timer_get_time() / 1000000);
+}
@@ -0,0 +1,110 @@
+/**
+ * HistoryLog.h - Sensor history and event log for Cortex Link A8R-M ESP32 IoT Smart Home Controller
+ *
+ * Keeps a ring of periodic samples and a ring of events, both taken from
+ * the process image, and serves them as Modbus file records (FC20/21), so
+ * a master can download the whole history in a few large requests.
+ *
+ * Both files start with a 4 record header, followed by the ring slots:
+ *   record 0  Entries held (write 0 to clear the file)
+ *   record 1  Records per entry
+ *   record 2  Slot of the next entry (= oldest entry once the ring is full)
+ *   record 3  Slots in the ring
+ *   slot n    records 4 + n * (records per entry)
+ * Slots do not move when entries are added, so a download that spans
+ * several requests stays consistent; entries carry their own time stamp.
+ *
+ * History entry (MB_FILE_HISTORY), signed values in two's complement:
+ *   uptime in s (2 records, high word first), voltages in mV, currents
+ *   in uA, DHT22 temperatures in 0.1 degC (0x8000 = no sensor), DHT22
+ *   humidities in 0.1 %RH (0xFFFF = no sensor), inputs | relays << 8,
+ *   first DS18B20 in 0.1 degC (0x8000 = no sensor)
+ * Event entry (MB_FILE_EVENTS):
+ *   uptime in s (2 records, high word first), type << 8 | index, value
+ *
+ * Events are found by comparing process image snapshots, so an input
+ * pulse shorter than the acquisition period can be missed.
+ */
+
+#ifndef HISTORY_LOG_H
+#define HISTORY_LOG_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "ModbusComm.h"
+#include "ProcessImage.h"
+
+enum HistoryEvent {
+    HIST_EVENT_BOOT = 1,        // Board started, value 0
+    HIST_EVENT_INPUT,           // Digital input changed, value = new state
+    HIST_EVENT_RELAY,           // Relay changed, value = new state
+    HIST_EVENT_DHT,             // DHT22 found (1) or lost (0)
+    HIST_EVENT_DS18B20,         // DS18B20 count changed, value = new count
+    HIST_EVENT_CLEARED          // File cleared by the bus, index = file number
+};
+
+#define HISTORY_HEADER_REGS     4
+#define HISTORY_SAMPLE_REGS     (2 + NUM_ANALOG_CHANNELS + NUM_CURRENT_CHANNELS + 2 * NUM_DHT_SENSORS + 2)
+#define HISTORY_EVENT_REGS      4
+
+static_assert(HISTORY_HEADER_REGS + HISTORY_DEPTH * HISTORY_SAMPLE_REGS - 1 <= MB_FILE_MAX_RECORD,
+              "HISTORY_DEPTH does not fit the file record numbers");
+static_assert(HISTORY_HEADER_REGS + EVENT_LOG_DEPTH * HISTORY_EVENT_REGS - 1 <= MB_FILE_MAX_RECORD,
+              "EVENT_LOG_DEPTH does not fit the file record numbers");
+
+class HistoryLog {
+public:
+    HistoryLog();
+
+    /**
+     * Take the first sample, log the boot event and register both files
+     * @return false if the server refused a file
+     */
+    bool begin(ModbusComm& comm, ProcessImage& image);
+
+    /**
+     * Log events from new snapshots and take a sample every
+     * HISTORY_INTERVAL ms (call this in the loop)
+     */
+    void task();
+
+    /**
+     * Add an event to the event log
+     */
+    void logEvent(HistoryEvent type, uint8_t index, uint16_t value);
+
+private:
+    // One ring of fixed-size entries behind a file header
+    struct Ring {
+        uint16_t* slots;
+        uint16_t depth;
+        uint16_t entryRegs;
+        uint16_t next;
+        uint16_t count;
+    };
+
+    ProcessImage* image;
+
+    uint16_t samples[HISTORY_DEPTH * HISTORY_SAMPLE_REGS];
+    uint16_t events[EVENT_LOG_DEPTH * HISTORY_EVENT_REGS];
+    Ring history;
+    Ring eventLog;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    unsigned long lastSample;
+    uint32_t lastSequence;
+    uint8_t lastInputs;
+    uint8_t lastRelays;
+    uint8_t lastDhtConnected;
+    uint8_t lastDs18b20Count;
+
+    void takeSample(const ProcessImageData& data);
+    void detectEvents(const ProcessImageData& data);
+    void remember(const ProcessImageData& data);
+    void append(Ring& ring, const uint16_t* entry);
+    uint8_t handleFiles(ModbusFileBlock& block);
+    uint8_t handleFile(Ring& ring, ModbusFileBlock& block);
+    static uint32_t uptime();
+};
+
+#endif // HISTORY_LOG_H
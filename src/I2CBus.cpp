@@ -0,0 +1,552 @@
+/**
+ * I2CBus.cpp - Implementation of the I2C bus manager
+ */
+
+#include "I2CBus.h"
+
+static const uint32_t clockSteps[] = I2C_CLOCK_STEPS;
+static const uint8_t CLOCK_STEP_COUNT = sizeof(clockSteps) / sizeof(clockSteps[0]);
+
+static const uint16_t bucketLimits[I2C_HISTOGRAM_BUCKETS - 1] = {
+    50, 100, 200, 500, 1000, 2000, 5000
+};
+
+#if MB_I2C_BUS_REGS != 4 || MB_I2C_DEVICE_REGS != 8 + I2C_HISTOGRAM_BUCKETS
+#error "MB_I2C_BUS_REGS must be 4, MB_I2C_DEVICE_REGS must hold 8 counters and the histogram"
+#endif
+
+// Half an SCL period while the bus is recovered by hand (~100 kHz)
+#define RECOVERY_HALF_PERIOD_US  5
+
+I2CTransaction::I2CTransaction() :
+    address(0),
+    txLength(0),
+    rxData(nullptr),
+    rxLength(0),
+    priority(I2C_PRIO_NORMAL),
+    job(nullptr),
+    context(nullptr),
+    result(I2C_RESULT_IDLE),
+    done(nullptr)
+{
+}
+
+I2CBus::I2CBus(TwoWire& bus) :
+    wire(bus),
+    taskHandle(nullptr),
+    queueCount(0),
+    deviceCount(0),
+    clockStep(0),
+    clock(I2C_CLOCK_HZ),
+    faultRun(0),
+    cleanRun(0),
+    recoverThreshold(I2C_RECOVER_SUCCESSES),
+    transactions(0),
+    errors(0),
+    retries(0),
+    fallbacks(0),
+    recoveries(0),
+    busyMicros(0),
+    windowStart(0),
+    utilization(0)
+{
+    memset(devices, 0, sizeof(devices));
+}
+
+bool I2CBus::begin() {
+    windowStart = millis();
+
+    // A device may still hold SDA from a transfer cut off by an ESP32 reset
+    releaseBus();
+
+    clock = I2C_CLOCK_HZ;
+    if (!wire.begin(I2C_SDA_PIN, I2C_SCK_PIN, clock)) {
+        return false;
+    }
+    wire.setTimeOut(I2C_TIMEOUT_MS);
+    return true;
+}
+
+bool I2CBus::addDevice(uint8_t address, uint32_t maxClock) {
+    Device* device = findDevice(address, true);
+    if (device == nullptr) {
+        return false;
+    }
+
+    device->maxClock = maxClock;
+    return true;
+}
+
+// Slot of a device, a new one (at I2C_CLOCK_HZ) if create is set
+I2CBus::Device* I2CBus::findDevice(uint8_t address, bool create) {
+    if (address == 0) {
+        return nullptr;
+    }
+
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        if (devices[i].stats.address == address) {
+            return &devices[i];
+        }
+    }
+
+    if (!create || deviceCount >= I2C_MAX_DEVICES) {
+        return nullptr;  // Table full, the device runs untracked at I2C_CLOCK_HZ
+    }
+
+    Device* device = &devices[deviceCount++];
+    device->maxClock = I2C_CLOCK_HZ;
+    device->stats.address = address;
+    return device;
+}
+
+const I2CDeviceStats* I2CBus::getDeviceStats(uint8_t address) const {
+    const Device* device = const_cast<I2CBus*>(this)->findDevice(address, false);
+    return (device != nullptr) ? &device->stats : nullptr;
+}
+
+uint16_t I2CBus::getBucketLimit(uint8_t bucket) {
+    return (bucket < I2C_HISTOGRAM_BUCKETS - 1) ? bucketLimits[bucket] : 0;
+}
+
+uint32_t I2CBus::getClockLimit() const {
+    return clockSteps[clockStep];
+}
+
+bool I2CBus::startTask(BaseType_t core, UBaseType_t priority) {
+    if (taskHandle != nullptr) {
+        return true;
+    }
+
+    if (xTaskCreatePinnedToCore(taskLoop, "i2c", I2C_TASK_STACK, this, priority,
+                                &taskHandle, core) != pdPASS) {
+        taskHandle = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void I2CBus::taskLoop(void* arg) {
+    I2CBus* bus = static_cast<I2CBus*>(arg);
+
+    for (;;) {
+        // Woken by submit(), or once per window to close an idle one
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(I2C_STATS_WINDOW));
+
+        I2CTransaction* txn;
+        while ((txn = bus->takeNext()) != nullptr) {
+            bus->execute(*txn);
+        }
+        bus->account(0, I2C_RESULT_IDLE);
+    }
+}
+
+bool I2CBus::validate(I2CTransaction& txn) {
+    if (txn.job == nullptr &&
+        ((txn.txLength == 0 && txn.rxLength == 0) || txn.txLength > I2C_MAX_WRITE ||
+         (txn.rxLength > 0 && txn.rxData == nullptr))) {
+        txn.result = I2C_RESULT_INVALID_REQUEST;
+        return false;
+    }
+
+    txn.result = I2C_RESULT_PENDING;
+    return true;
+}
+
+bool I2CBus::submit(I2CTransaction& txn) {
+    if (!validate(txn)) {
+        return false;
+    }
+
+    // Before the task runs, the caller owns the bus
+    if (taskHandle == nullptr) {
+        execute(txn);
+        return true;
+    }
+
+    portENTER_CRITICAL(&lock);
+    bool queued = queueCount < I2C_QUEUE_SIZE;
+    if (queued) {
+        queue[queueCount++] = &txn;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if (!queued) {
+        txn.result = I2C_RESULT_QUEUE_FULL;
+        return false;
+    }
+
+    xTaskNotifyGive(taskHandle);
+    return true;
+}
+
+bool I2CBus::transfer(I2CTransaction& txn) {
+    // A job or callback on the bus task already owns the bus
+    if (taskHandle == nullptr || xTaskGetCurrentTaskHandle() == taskHandle) {
+        if (!validate(txn)) {
+            return false;
+        }
+        execute(txn);
+        return txn.result == I2C_RESULT_SUCCESS;
+    }
+
+    StaticSemaphore_t doneBuffer;
+    txn.done = xSemaphoreCreateBinaryStatic(&doneBuffer);
+    bool ok = submit(txn);
+    if (ok) {
+        xSemaphoreTake(txn.done, portMAX_DELAY);
+    }
+    txn.done = nullptr;
+
+    return ok && txn.result == I2C_RESULT_SUCCESS;
+}
+
+bool I2CBus::writeRegister(uint8_t address, uint8_t reg, uint8_t value, I2CPriority priority) {
+    I2CTransaction txn;
+    txn.address = address;
+    txn.txData[0] = reg;
+    txn.txData[1] = value;
+    txn.txLength = 2;
+    txn.priority = priority;
+    return transfer(txn);
+}
+
+bool I2CBus::readRegisters(uint8_t address, uint8_t reg, uint8_t* values, uint8_t count, I2CPriority priority) {
+    I2CTransaction txn;
+    txn.address = address;
+    txn.txData[0] = reg;
+    txn.txLength = 1;
+    txn.rxData = values;
+    txn.rxLength = count;
+    txn.priority = priority;
+    return transfer(txn);
+}
+
+bool I2CBus::run(I2CJob job, void* context, I2CPriority priority, uint8_t address) {
+    I2CTransaction txn;
+    txn.address = address;
+    txn.job = job;
+    txn.context = context;
+    txn.priority = priority;
+    return transfer(txn);
+}
+
+I2CTransaction* I2CBus::takeNext() {
+    portENTER_CRITICAL(&lock);
+    if (queueCount == 0) {
+        portEXIT_CRITICAL(&lock);
+        return nullptr;
+    }
+
+    // Most urgent first, oldest first within a priority
+    uint8_t best = 0;
+    for (uint8_t i = 1; i < queueCount; i++) {
+        if (queue[i]->priority > queue[best]->priority) {
+            best = i;
+        }
+    }
+
+    I2CTransaction* txn = queue[best];
+    for (uint8_t i = best; i + 1 < queueCount; i++) {
+        queue[i] = queue[i + 1];
+    }
+    queueCount--;
+    portEXIT_CRITICAL(&lock);
+
+    return txn;
+}
+
+void I2CBus::execute(I2CTransaction& txn) {
+    unsigned long start = micros();
+    Device* device = findDevice(txn.address, true);
+
+    uint32_t counted = transactions;
+
+    I2CResult result;
+    if (txn.job != nullptr) {
+        // A job may not be safe to repeat, so it gets a single attempt
+        applyClock(device);
+        result = txn.job(wire, txn.context) ? I2C_RESULT_SUCCESS : I2C_RESULT_JOB_FAILED;
+    } else {
+        result = attempt(txn, device);
+        for (uint8_t retry = 0; retry < I2C_RETRIES && result != I2C_RESULT_SUCCESS; retry++) {
+            retries++;
+            if (device != nullptr) {
+                device->stats.retries++;
+            }
+            result = attempt(txn, device);
+        }
+    }
+
+    // A job that went through transfer() was counted there
+    if (txn.job == nullptr || transactions == counted) {
+        record(device, txn, result, micros() - start);
+        account(start, result);
+    }
+
+    txn.result = result;
+    if (txn.callback) {
+        txn.callback(txn);
+    }
+    if (txn.done != nullptr) {
+        xSemaphoreGive(txn.done);
+    }
+}
+
+// One try of a transfer, at the clock its device and the fallback allow
+I2CResult I2CBus::attempt(I2CTransaction& txn, Device* device) {
+    applyClock(device);
+    I2CResult result = transferBytes(txn);
+    adaptClock(result);
+
+    if (device != nullptr) {
+        if (result == I2C_RESULT_NACK_ADDRESS || result == I2C_RESULT_NACK_DATA) {
+            device->stats.nacks++;
+        }
+        else if (result == I2C_RESULT_TIMEOUT || result == I2C_RESULT_BUS_ERROR) {
+            device->stats.timeouts++;
+        }
+    }
+
+    if (result == I2C_RESULT_TIMEOUT || result == I2C_RESULT_BUS_ERROR) {
+        recoverBus();
+    }
+
+    return result;
+}
+
+I2CResult I2CBus::transferBytes(I2CTransaction& txn) {
+    if (txn.txLength > 0) {
+        wire.beginTransmission(txn.address);
+        wire.write(txn.txData, txn.txLength);
+
+        // Keep the bus for the read: repeated start instead of STOP
+        I2CResult result = writeResult(wire.endTransmission(txn.rxLength == 0));
+        if (result != I2C_RESULT_SUCCESS) {
+            return result;
+        }
+    }
+
+    if (txn.rxLength > 0) {
+        uint8_t received = wire.requestFrom(txn.address, txn.rxLength);
+        if (received > 0) {
+            wire.readBytes(txn.rxData, received);
+        }
+        if (received == 0) {
+            return readError(txn.address);
+        }
+        if (received < txn.rxLength) {
+            return I2C_RESULT_SHORT_READ;
+        }
+    }
+
+    return I2C_RESULT_SUCCESS;
+}
+
+I2CResult I2CBus::readError(uint8_t address) {
+    // After a repeated start, endTransmission(false) only buffered the
+    // register address, so any failure shows up as an empty read. An
+    // address-only write tells a missing device from a bus that timed out.
+    wire.beginTransmission(address);
+    I2CResult probe = writeResult(wire.endTransmission(true));
+
+    // The device answers its address: the read itself failed on the bus
+    return (probe == I2C_RESULT_SUCCESS) ? I2C_RESULT_BUS_ERROR : probe;
+}
+
+I2CResult I2CBus::writeResult(uint8_t status) {
+    switch (status) {
+        case 0:
+            return I2C_RESULT_SUCCESS;
+        case 2:
+            return I2C_RESULT_NACK_ADDRESS;
+        case 3:
+            return I2C_RESULT_NACK_DATA;
+        case 5:
+            return I2C_RESULT_TIMEOUT;
+        default:
+            return I2C_RESULT_BUS_ERROR;
+    }
+}
+
+void I2CBus::applyClock(const Device* device) {
+    uint32_t hz = clockSteps[clockStep];
+
+    uint32_t deviceClock = (device != nullptr) ? device->maxClock : I2C_CLOCK_HZ;
+    if (deviceClock < hz) {
+        hz = deviceClock;
+    }
+
+    if (hz != clock) {
+        wire.setClock(hz);
+        clock = hz;
+    }
+}
+
+void I2CBus::adaptClock(I2CResult result) {
+    if (result == I2C_RESULT_SUCCESS) {
+        faultRun = 0;
+        if (clockStep > 0 && ++cleanRun >= recoverThreshold) {
+            clockStep--;
+            cleanRun = 0;
+        }
+        return;
+    }
+
+    // A missing device is the usual cause, not the clock
+    if (result == I2C_RESULT_NACK_ADDRESS) {
+        return;
+    }
+
+    cleanRun = 0;
+    if (++faultRun < I2C_FALLBACK_ERRORS) {
+        return;
+    }
+    faultRun = 0;
+
+    // Step below the clock that failed; lowering the limit to a speed the
+    // device never ran at would not change anything
+    uint8_t step = clockStep;
+    while (step + 1 < CLOCK_STEP_COUNT && clockSteps[step] >= clock) {
+        step++;
+    }
+    if (step != clockStep && clockSteps[step] < clock) {
+        clockStep = step;
+        fallbacks++;
+        recoverThreshold = (recoverThreshold * 2 > I2C_RECOVER_MAX) ? I2C_RECOVER_MAX : recoverThreshold * 2;
+    }
+}
+
+// Stuck-bus recovery: free SDA by hand, then restart the I2C peripheral
+void I2CBus::recoverBus() {
+    wire.end();
+    releaseBus();
+    wire.begin(I2C_SDA_PIN, I2C_SCK_PIN, clock);
+    wire.setTimeOut(I2C_TIMEOUT_MS);
+    recoveries++;
+}
+
+// Clock SCL until a device that stopped mid-byte releases SDA (at most
+// nine bits), then generate a STOP. Wire must not own the pins.
+void I2CBus::releaseBus() {
+    pinMode(I2C_SDA_PIN, INPUT_PULLUP);
+    pinMode(I2C_SCK_PIN, OUTPUT_OPEN_DRAIN);
+    digitalWrite(I2C_SCK_PIN, HIGH);
+    delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+
+    for (uint8_t bit = 0; bit < 9 && digitalRead(I2C_SDA_PIN) == LOW; bit++) {
+        digitalWrite(I2C_SCK_PIN, LOW);
+        delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+        digitalWrite(I2C_SCK_PIN, HIGH);
+        delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+    }
+
+    // STOP: SDA rises while SCL is high
+    digitalWrite(I2C_SCK_PIN, LOW);
+    pinMode(I2C_SDA_PIN, OUTPUT_OPEN_DRAIN);
+    digitalWrite(I2C_SDA_PIN, LOW);
+    delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+    digitalWrite(I2C_SCK_PIN, HIGH);
+    delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+    digitalWrite(I2C_SDA_PIN, HIGH);
+    delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+}
+
+void I2CBus::record(Device* device, const I2CTransaction& txn, I2CResult result, uint32_t latencyMicros) {
+    if (device == nullptr) {
+        return;
+    }
+
+    I2CDeviceStats& stats = device->stats;
+    stats.transactions++;
+    if (result != I2C_RESULT_SUCCESS) {
+        stats.failures++;
+    }
+    else if (txn.job == nullptr) {
+        stats.bytes += txn.txLength + txn.rxLength;
+    }
+
+    uint16_t latency = (latencyMicros > 0xFFFF) ? 0xFFFF : latencyMicros;
+    if (latency > stats.maxLatency) {
+        stats.maxLatency = latency;
+    }
+
+    uint8_t bucket = 0;
+    while (bucket < I2C_HISTOGRAM_BUCKETS - 1 && latency >= bucketLimits[bucket]) {
+        bucket++;
+    }
+    stats.histogram[bucket]++;
+}
+
+uint16_t I2CBus::deviceRegister(const I2CDeviceStats& stats, uint8_t field) {
+    switch (field) {
+        case 0: return stats.address;
+        case 1: return stats.transactions;
+        case 2: return stats.failures;
+        case 3: return stats.nacks;
+        case 4: return stats.timeouts;
+        case 5: return stats.retries;
+        case 6: return stats.bytes;
+        case 7: return stats.maxLatency;
+        default: return stats.histogram[field - 8];
+    }
+}
+
+void I2CBus::readStatsWindow(uint16_t offset, uint16_t count, uint16_t* values) const {
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t index = offset + i;
+
+        switch (index) {
+            case 0: values[i] = getClockLimit() / 1000; break;
+            case 1: values[i] = utilization; break;
+            case 2: values[i] = fallbacks; break;
+            case 3: values[i] = recoveries; break;
+            default:
+                if (index < MB_I2C_WINDOW_SIZE) {
+                    index -= MB_I2C_BUS_REGS;
+                    values[i] = deviceRegister(devices[index / MB_I2C_DEVICE_REGS].stats, index % MB_I2C_DEVICE_REGS);
+                }
+                else {
+                    values[i] = 0;
+                }
+                break;
+        }
+    }
+}
+
+void I2CBus::printStats(Print& out) const {
+    out.printf("I2C: %u%% busy, %lu kHz limit, %lu transactions, %lu errors, %lu retries, %lu fallbacks, %lu recoveries\n",
+               utilization, (unsigned long)(getClockLimit() / 1000), (unsigned long)transactions,
+               (unsigned long)errors, (unsigned long)retries, (unsigned long)fallbacks, (unsigned long)recoveries);
+
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        const I2CDeviceStats& stats = devices[i].stats;
+        out.printf("  0x%02X: %u txn, %u failed, %u NACK, %u timeout, %u retry, %u bytes, max %u us, hist",
+                   stats.address, stats.transactions, stats.failures, stats.nacks, stats.timeouts,
+                   stats.retries, stats.bytes, stats.maxLatency);
+        for (uint8_t b = 0; b < I2C_HISTOGRAM_BUCKETS; b++) {
+            out.printf(" %u", stats.histogram[b]);
+        }
+        out.println();
+    }
+}
+
+// Count a finished transaction (I2C_RESULT_IDLE: none, only close the
+// window if it is over)
+void I2CBus::account(unsigned long startMicros, I2CResult result) {
+    if (result != I2C_RESULT_IDLE) {
+        busyMicros += micros() - startMicros;
+        transactions++;
+        if (result != I2C_RESULT_SUCCESS) {
+            errors++;
+        }
+    }
+
+    unsigned long elapsed = millis() - windowStart;
+    if (elapsed >= I2C_STATS_WINDOW) {
+        uint32_t percent = busyMicros / (elapsed * 10);
+        utilization = (percent > 100) ? 100 : percent;
+        busyMicros = 0;
+        windowStart += elapsed;
+    }
+}
@@ -0,0 +1,245 @@
+/**
+ * I2CBus.h - I2C bus manager for Cortex Link A8R-M ESP32 IoT Smart Home Controller
+ *
+ * One FreeRTOS task owns Wire. Drivers queue transactions (write, read, or
+ * write then read with a repeated start) with a priority; the task always
+ * starts the most urgent one next, in submission order within a priority,
+ * and reports the result through an optional completion callback. Relay
+ * writes therefore overtake background input polling. Code that has to
+ * drive Wire itself (driver libraries) is queued as a job that runs on the
+ * bus task. Drivers never touch the bus clock.
+ *
+ * Every transfer runs at the fastest step of I2C_CLOCK_STEPS that is not
+ * above its device's registered limit. A failed transfer is retried, and
+ * after I2C_FALLBACK_ERRORS bus faults in a row the bus steps below the
+ * failing clock. It steps back up after I2C_RECOVER_SUCCESSES clean
+ * transfers, a count that doubles on each fallback so a marginal bus
+ * settles at the speed it holds. A timeout or bus error also recovers the
+ * bus: SCL is clocked until the device holding SDA lets go, a STOP is
+ * generated and the I2C peripheral is restarted.
+ *
+ * Each device address gets its own counters and a latency histogram, so
+ * a device that slows the bus down shows up in the statistics window
+ * (MB_REG_I2C_START) and the status print.
+ *
+ * Until startTask() is called every transaction runs in the caller, so
+ * drivers can be set up in setup() the same way. Blocking calls wait on a
+ * semaphore and never poll.
+ */
+
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "Config.h"
+
+enum I2CPriority {
+    I2C_PRIO_LOW,                // Background polling
+    I2C_PRIO_NORMAL,
+    I2C_PRIO_HIGH                // Outputs (relays, W5500 reset)
+};
+
+enum I2CResult {
+    I2C_RESULT_IDLE,             // Never submitted
+    I2C_RESULT_PENDING,          // Queued or on the bus
+    I2C_RESULT_SUCCESS,
+    I2C_RESULT_NACK_ADDRESS,     // No device at the address
+    I2C_RESULT_NACK_DATA,        // Device rejected a data byte
+    I2C_RESULT_SHORT_READ,       // Fewer bytes received than requested
+    I2C_RESULT_TIMEOUT,
+    I2C_RESULT_BUS_ERROR,        // Arbitration lost or other bus error
+    I2C_RESULT_JOB_FAILED,       // A job returned false
+    I2C_RESULT_INVALID_REQUEST,  // Nothing to do or too many bytes
+    I2C_RESULT_QUEUE_FULL
+};
+
+// Statistics of one device. Counters are 16 bit and wrap.
+struct I2CDeviceStats {
+    uint8_t address;                 // 0 = slot unused
+    uint16_t transactions;
+    uint16_t failures;               // Failed after all retries
+    uint16_t nacks;                  // Attempts NACKed (address or data)
+    uint16_t timeouts;               // Attempts that timed out or hit a bus error
+    uint16_t retries;
+    uint16_t bytes;                  // Bytes moved by successful transfers
+    uint16_t maxLatency;             // us from start to result, retries included
+    uint16_t histogram[I2C_HISTOGRAM_BUCKETS];
+};
+
+struct I2CTransaction;
+
+// Completion callback, runs on the bus task
+typedef std::function<void(I2CTransaction& txn)> cbI2CTransaction;
+
+// Job run on the bus task with exclusive use of Wire, false = failed
+typedef bool (*I2CJob)(TwoWire& wire, void* context);
+
+// One bus transaction. The caller owns the object and must keep it (and
+// its receive buffer) alive while result is I2C_RESULT_PENDING.
+struct I2CTransaction {
+    uint8_t address;
+    uint8_t txData[I2C_MAX_WRITE];   // Written first, usually a register address
+    uint8_t txLength;
+    uint8_t* rxData;                 // Read after a repeated start, if rxLength > 0
+    uint8_t rxLength;
+    I2CPriority priority;
+    I2CJob job;                      // Runs instead of the transfer if set
+    void* context;                   // Passed to job
+    cbI2CTransaction callback;
+
+    // Filled in by I2CBus
+    volatile I2CResult result;
+    SemaphoreHandle_t done;          // Given on completion of a blocking call
+
+    I2CTransaction();
+    bool isDone() const { return result != I2C_RESULT_PENDING && result != I2C_RESULT_IDLE; }
+};
+
+class I2CBus {
+public:
+    I2CBus(TwoWire& wire = Wire);
+
+    /**
+     * Release a bus left busy by a reset, then start Wire on the board's
+     * pins at I2C_CLOCK_HZ
+     */
+    bool begin();
+
+    /**
+     * Register a device and the fastest clock it allows. Unregistered
+     * addresses run at I2C_CLOCK_HZ at most.
+     */
+    bool addDevice(uint8_t address, uint32_t maxClock);
+
+    /**
+     * Run the queue from a dedicated task. Transactions submitted before
+     * run in the caller.
+     */
+    bool startTask(BaseType_t core = I2C_TASK_CORE, UBaseType_t priority = I2C_TASK_PRIORITY);
+    bool isTaskRunning() const { return taskHandle != nullptr; }
+
+    /**
+     * Queue a transaction, its result and callback are set by the bus task
+     * @return false if the request is invalid or the queue is full
+     */
+    bool submit(I2CTransaction& txn);
+
+    /**
+     * Submit a transaction and wait for it
+     * @return true if it succeeded
+     */
+    bool transfer(I2CTransaction& txn);
+
+    /**
+     * Write one 8-bit register and wait
+     */
+    bool writeRegister(uint8_t address, uint8_t reg, uint8_t value, I2CPriority priority = I2C_PRIO_NORMAL);
+
+    /**
+     * Read consecutive 8-bit registers and wait
+     */
+    bool readRegisters(uint8_t address, uint8_t reg, uint8_t* values, uint8_t count,
+                       I2CPriority priority = I2C_PRIO_NORMAL);
+
+    /**
+     * Run a job on the bus task and wait for it, at the clock allowed for
+     * the device at address
+     * @return The job's result
+     */
+    bool run(I2CJob job, void* context, I2CPriority priority = I2C_PRIO_NORMAL, uint8_t address = 0);
+
+    /**
+     * Share of the last I2C_STATS_WINDOW ms the bus was busy, in percent
+     */
+    uint8_t getUtilization() const { return utilization; }
+
+    uint32_t getTransactionCount() const { return transactions; }
+    uint32_t getErrorCount() const { return errors; }
+    uint32_t getRetryCount() const { return retries; }
+    uint32_t getFallbackCount() const { return fallbacks; }
+    uint32_t getRecoveryCount() const { return recoveries; }
+
+    /**
+     * Clock limit the fallback currently allows, in Hz
+     */
+    uint32_t getClockLimit() const;
+
+    /**
+     * Statistics of one device
+     * @return nullptr if nothing was sent to the address (or no slot was free)
+     */
+    const I2CDeviceStats* getDeviceStats(uint8_t address) const;
+
+    /**
+     * Upper limit of a latency bucket in us (0 for the last, open bucket)
+     */
+    static uint16_t getBucketLimit(uint8_t bucket);
+
+    /**
+     * Copy part of the statistics window (layout in Config.h)
+     * @param offset First register relative to MB_REG_I2C_START
+     */
+    void readStatsWindow(uint16_t offset, uint16_t count, uint16_t* values) const;
+
+    /**
+     * Print the bus state and one line per device
+     */
+    void printStats(Print& out) const;
+
+    /**
+     * Transactions waiting for the bus
+     */
+    uint8_t pendingTransactions() const { return queueCount; }
+
+private:
+    TwoWire& wire;
+    TaskHandle_t taskHandle;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    I2CTransaction* queue[I2C_QUEUE_SIZE];
+    uint8_t queueCount;
+
+    // Devices seen on the bus
+    struct Device {
+        uint32_t maxClock;
+        I2CDeviceStats stats;
+    };
+    Device devices[I2C_MAX_DEVICES];
+    uint8_t deviceCount;
+
+    // Clock fallback
+    uint8_t clockStep;               // Index into I2C_CLOCK_STEPS
+    uint32_t clock;                  // Clock Wire runs at
+    uint8_t faultRun;                // Bus faults in a row
+    uint32_t cleanRun;               // Clean transfers since the last step
+    uint32_t recoverThreshold;
+
+    uint32_t transactions;
+    uint32_t errors;
+    uint32_t retries;
+    uint32_t fallbacks;
+    uint32_t recoveries;
+    uint32_t busyMicros;             // Busy time in the current window
+    unsigned long windowStart;
+    uint8_t utilization;
+
+    static void taskLoop(void* arg);
+    static bool validate(I2CTransaction& txn);
+    I2CTransaction* takeNext();
+    void execute(I2CTransaction& txn);
+    Device* findDevice(uint8_t address, bool create);
+    I2CResult attempt(I2CTransaction& txn, Device* device);
+    I2CResult transferBytes(I2CTransaction& txn);
+    I2CResult readError(uint8_t address);
+    static I2CResult writeResult(uint8_t status);
+    void applyClock(const Device* device);
+    void adaptClock(I2CResult result);
+    void recoverBus();
+    static void releaseBus();
+    static void record(Device* device, const I2CTransaction& txn, I2CResult result, uint32_t latencyMicros);
+    static uint16_t deviceRegister(const I2CDeviceStats& stats, uint8_t field);
+    void account(unsigned long startMicros, I2CResult result);
+};
+
+#endif // I2C_BUS_H
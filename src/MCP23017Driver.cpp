@@ -0,0 +1,148 @@
+/**
+ * MCP23017Driver.cpp - Implementation of the shadow-register MCP23017 driver
+ */
+
+#include "MCP23017Driver.h"
+
+// With BANK = 1 this address is IOCON, with BANK = 0 it is GPINTENB,
+// which the configuration burst overwrites anyway
+#define MCP_BANK1_IOCON     0x05
+
+// IODIR through GPPU of both ports
+#define MCP_CONFIG_REGS     14
+
+static_assert(MCP_CONFIG_REGS + 1 <= I2C_MAX_WRITE, "I2C_MAX_WRITE too small for the MCP23017 burst");
+
+MCP23017Driver::MCP23017Driver(uint8_t addr) :
+    bus(nullptr),
+    address(addr),
+    iodir(0xFFFF),
+    gppu(0),
+    olat(0),
+    gpinten(0),
+    intcon(0)
+{
+}
+
+bool MCP23017Driver::begin(I2CBus& i2c, const MCP23017Config& config) {
+    bus = &i2c;
+    bus->addDevice(address, MCP23017_MAX_CLOCK_HZ);
+
+    // Back to BANK = 0 in case the chip kept another layout across an
+    // ESP32 reset
+    uint8_t iocon = 0;
+    bool ok = writeRegisters(MCP_BANK1_IOCON, &iocon, 1, I2C_PRIO_NORMAL);
+
+    // With BANK = 0 the write above missed IOCON. SEQOP = 1 (left by the
+    // Adafruit library) would make the bursts below repeat one register
+    // pair, so IOCON is written on its own first.
+    iocon = config.iocon & ~(MCP_IOCON_BANK | MCP_IOCON_SEQOP);
+    ok = ok && writeRegisters(MCP_REG_IOCON, &iocon, 1, I2C_PRIO_NORMAL);
+
+    // Latches first, so new outputs start at their level
+    uint8_t latches[2] = { (uint8_t)(config.olat & 0xFF), (uint8_t)(config.olat >> 8) };
+    ok = ok && writeRegisters(MCP_REG_OLAT, latches, 2, I2C_PRIO_NORMAL);
+
+    // Sequential addressing: both ports' registers alternate A, B
+    uint8_t burst[MCP_CONFIG_REGS];
+    const uint16_t pairs[] = { config.iodir, config.ipol, config.gpinten, config.defval, config.intcon };
+    for (uint8_t i = 0; i < 5; i++) {
+        burst[i * 2] = pairs[i] & 0xFF;
+        burst[i * 2 + 1] = pairs[i] >> 8;
+    }
+    burst[MCP_REG_IOCON] = iocon;
+    burst[MCP_REG_IOCON + 1] = iocon;
+    burst[MCP_REG_GPPU] = config.gppu & 0xFF;
+    burst[MCP_REG_GPPU + 1] = config.gppu >> 8;
+    ok = ok && writeRegisters(MCP_REG_IODIR, burst, MCP_CONFIG_REGS, I2C_PRIO_NORMAL);
+
+    if (ok) {
+        iodir = config.iodir;
+        gppu = config.gppu;
+        olat = config.olat;
+        gpinten = config.gpinten;
+        intcon = config.intcon;
+    }
+
+    return ok;
+}
+
+bool MCP23017Driver::pinMode(uint8_t pin, uint8_t mode, I2CPriority priority) {
+    if (pin > 15) {
+        return false;
+    }
+
+    uint16_t bit = 1 << pin;
+    MCP23017PortId port = (pin < 8) ? MCP_PORT_A : MCP_PORT_B;
+    uint16_t newIodir = (mode == OUTPUT) ? (iodir & ~bit) : (iodir | bit);
+    uint16_t newGppu = (mode == INPUT_PULLUP) ? (gppu | bit) : (gppu & ~bit);
+
+    bool ok = true;
+    if (newGppu != gppu) {
+        ok = writePortRegister(MCP_REG_GPPU, port, newGppu, priority);
+        if (ok) {
+            gppu = newGppu;
+        }
+    }
+    if (ok && newIodir != iodir) {
+        ok = writePortRegister(MCP_REG_IODIR, port, newIodir, priority);
+        if (ok) {
+            iodir = newIodir;
+        }
+    }
+
+    return ok;
+}
+
+bool MCP23017Driver::digitalWrite(uint8_t pin, uint8_t level, I2CPriority priority) {
+    if (pin > 15) {
+        return false;
+    }
+
+    uint8_t bit = 1 << (pin % 8);
+    return writePins((pin < 8) ? MCP_PORT_A : MCP_PORT_B, bit, level ? bit : 0, priority);
+}
+
+bool MCP23017Driver::writePins(MCP23017PortId port, uint8_t mask, uint8_t values, I2CPriority priority) {
+    uint8_t shift = port * 8;
+    uint8_t current = olat >> shift;
+    return writePort(port, (current & ~mask) | (values & mask), priority);
+}
+
+bool MCP23017Driver::writePort(MCP23017PortId port, uint8_t value, I2CPriority priority) {
+    uint8_t shift = port * 8;
+    uint16_t newOlat = (olat & ~(0xFF << shift)) | ((uint16_t)value << shift);
+
+    // The cache follows the request, so a failed write is repeated by the
+    // next one
+    olat = newOlat;
+    return writePortRegister(MCP_REG_OLAT, port, newOlat, priority);
+}
+
+bool MCP23017Driver::readPort(MCP23017PortId port, uint8_t& value, I2CPriority priority) {
+    return bus->readRegisters(address, MCP_REG_GPIO + port, &value, 1, priority);
+}
+
+bool MCP23017Driver::readPorts(uint16_t& value, I2CPriority priority) {
+    uint8_t ports[2];
+    if (!bus->readRegisters(address, MCP_REG_GPIO, ports, 2, priority)) {
+        return false;
+    }
+    value = ports[0] | (ports[1] << 8);
+    return true;
+}
+
+bool MCP23017Driver::writeRegisters(uint8_t reg, const uint8_t* values, uint8_t count, I2CPriority priority) {
+    I2CTransaction txn;
+    txn.address = address;
+    txn.txData[0] = reg;
+    memcpy(&txn.txData[1], values, count);
+    txn.txLength = count + 1;
+    txn.priority = priority;
+    return bus->transfer(txn);
+}
+
+bool MCP23017Driver::writePortRegister(MCP23017Reg reg, MCP23017PortId port, uint16_t value, I2CPriority priority) {
+    uint8_t byte = value >> (port * 8);
+    return bus->writeRegister(address, reg + port, byte, priority);
+}
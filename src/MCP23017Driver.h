@@ -0,0 +1,124 @@
+/**
+ * MCP23017Driver.h - Shadow-register MCP23017 driver for Cortex Link A8R-M ESP32 IoT Smart Home Controller
+ *
+ * Keeps a copy of IODIR, GPPU, OLAT, GPINTEN and INTCON (and the other
+ * configuration registers), so changing a pin is one write of the whole
+ * port register from the cache instead of a read-modify-write. Reads and
+ * writes go through the I2C bus manager. The chip runs with IOCON.BANK = 0
+ * and sequential addressing, so begin() configures both ports with one
+ * burst and the two GPIO ports are read in one transaction.
+ *
+ * 16-bit values hold port A in bits 0-7 and port B in bits 8-15.
+ */
+
+#ifndef MCP23017_DRIVER_H
+#define MCP23017_DRIVER_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "I2CBus.h"
+
+enum MCP23017PortId {
+    MCP_PORT_A = 0,
+    MCP_PORT_B = 1
+};
+
+// Port A register addresses with IOCON.BANK = 0, port B is at +1
+enum MCP23017Reg {
+    MCP_REG_IODIR   = 0x00,
+    MCP_REG_IPOL    = 0x02,
+    MCP_REG_GPINTEN = 0x04,
+    MCP_REG_DEFVAL  = 0x06,
+    MCP_REG_INTCON  = 0x08,
+    MCP_REG_IOCON   = 0x0A,
+    MCP_REG_GPPU    = 0x0C,
+    MCP_REG_INTF    = 0x0E,
+    MCP_REG_INTCAP  = 0x10,
+    MCP_REG_GPIO    = 0x12,
+    MCP_REG_OLAT    = 0x14
+};
+
+// IOCON bits
+#define MCP_IOCON_BANK      0x80
+#define MCP_IOCON_MIRROR    0x40
+#define MCP_IOCON_SEQOP     0x20   // 1 = sequential addressing off
+#define MCP_IOCON_ODR       0x04
+#define MCP_IOCON_INTPOL    0x02
+
+// Register contents written by begin()
+struct MCP23017Config {
+    uint16_t iodir;          // 1 = input
+    uint16_t ipol;           // 1 = GPIO bit inverted
+    uint16_t gpinten;        // 1 = interrupt on change
+    uint16_t defval;         // Compare value for INTCON = 1
+    uint16_t intcon;         // 1 = compare against DEFVAL, 0 = against the previous value
+    uint8_t iocon;           // BANK and SEQOP are forced to 0
+    uint16_t gppu;           // 1 = 100k pull-up
+    uint16_t olat;           // Output latch, written before the directions
+};
+
+class MCP23017Driver {
+public:
+    MCP23017Driver(uint8_t address);
+
+    /**
+     * Configure the chip in four transactions: undo BANK = 1 should an
+     * earlier firmware have set it, clear SEQOP in IOCON, write the output
+     * latches, then burst every configuration register
+     * @return false if the chip did not acknowledge
+     */
+    bool begin(I2CBus& bus, const MCP23017Config& config);
+
+    /**
+     * Change one pin's direction and pull-up (INPUT, INPUT_PULLUP, OUTPUT).
+     * Only registers whose cached value changes are written.
+     */
+    bool pinMode(uint8_t pin, uint8_t mode, I2CPriority priority = I2C_PRIO_NORMAL);
+
+    /**
+     * Set one output pin, a whole-port OLAT write from the cache
+     */
+    bool digitalWrite(uint8_t pin, uint8_t level, I2CPriority priority = I2C_PRIO_NORMAL);
+
+    /**
+     * Set the pins in mask to values in one OLAT write
+     */
+    bool writePins(MCP23017PortId port, uint8_t mask, uint8_t values, I2CPriority priority = I2C_PRIO_NORMAL);
+
+    /**
+     * Write a whole output latch
+     */
+    bool writePort(MCP23017PortId port, uint8_t value, I2CPriority priority = I2C_PRIO_NORMAL);
+
+    /**
+     * Read one port's pin levels (GPIO, clears its interrupt)
+     */
+    bool readPort(MCP23017PortId port, uint8_t& value, I2CPriority priority = I2C_PRIO_NORMAL);
+
+    /**
+     * Read both ports in one transaction
+     */
+    bool readPorts(uint16_t& value, I2CPriority priority = I2C_PRIO_NORMAL);
+
+    /**
+     * Cached output latches
+     */
+    uint16_t getOutputLatch() const { return olat; }
+    uint8_t getAddress() const { return address; }
+
+private:
+    I2CBus* bus;
+    uint8_t address;
+
+    // Shadow registers
+    uint16_t iodir;
+    uint16_t gppu;
+    uint16_t olat;
+    uint16_t gpinten;
+    uint16_t intcon;
+
+    bool writeRegisters(uint8_t reg, const uint8_t* values, uint8_t count, I2CPriority priority);
+    bool writePortRegister(MCP23017Reg reg, MCP23017PortId port, uint16_t value, I2CPriority priority);
+};
+
+#endif // MCP23017_DRIVER_H
@@ -0,0 +1,169 @@
+/**
+ * ModbusAggregator.cpp - Implementation of the board aggregator
+ */
+
+#include "ModbusAggregator.h"
+
+static const uint8_t aggregatedBoards[] = MB_AGG_BOARDS;
+static_assert(sizeof(aggregatedBoards) <= MB_AGG_MAX_BOARDS, "More MB_AGG_BOARDS than MB_AGG_MAX_BOARDS");
+
+ModbusAggregator::ModbusAggregator() :
+    comm(nullptr),
+    boardCount(0),
+    activeBoard(-1),
+    activeWindow(false),
+    busy(false)
+{
+    memset(boards, 0, sizeof(boards));
+    memset(rxValues, 0, sizeof(rxValues));
+}
+
+bool ModbusAggregator::begin(ModbusComm& modbus) {
+    comm = &modbus;
+    txn.callback = [this](ModbusTransaction& t) { onComplete(t); };
+
+    // Spread the boards over one poll period
+    unsigned long now = millis();
+    boardCount = sizeof(aggregatedBoards);
+    for (uint8_t i = 0; i < boardCount; i++) {
+        boards[i].slaveId = aggregatedBoards[i];
+        boards[i].nextPoll = now + i * MB_AGG_POLL_PERIOD / boardCount;
+    }
+
+    if (boardCount == 0) {
+        return false;
+    }
+    return comm->addInputRegisterHandler(MB_AGG_REG_START, boardCount * MB_AGG_STRIDE,
+                                         cbModbus::bind<ModbusAggregator, &ModbusAggregator::handleRegisters>(this));
+}
+
+void ModbusAggregator::task() {
+    submitNext();
+}
+
+void ModbusAggregator::submitNext() {
+    if (comm == nullptr) {
+        return;
+    }
+
+    // task() and the completion callback (on the RTU task) may both get
+    // here, only one of them submits
+    portENTER_CRITICAL(&lock);
+    bool claimed = !busy;
+    busy = true;
+    portEXIT_CRITICAL(&lock);
+    if (!claimed) {
+        return;
+    }
+
+    // Most overdue board
+    unsigned long now = millis();
+    int8_t next = -1;
+    long mostOverdue = -1;
+    for (uint8_t i = 0; i < boardCount; i++) {
+        long overdue = (long)(now - boards[i].nextPoll);
+        if (overdue > mostOverdue) {
+            mostOverdue = overdue;
+            next = i;
+        }
+    }
+
+    if (next < 0) {
+        busy = false;
+        return;
+    }
+
+    // The change counter decides whether the whole window is worth reading
+    Board& board = boards[next];
+    activeWindow = !board.valid || board.needWindow || now - board.lastWindow >= MB_AGG_REFRESH_PERIOD;
+    if (activeWindow) {
+        txn.set(board.slaveId, MB_FC_READ_INPUT_REGS, MB_REG_BOARD_START, MB_BOARD_WINDOW_SIZE, rxValues);
+    } else {
+        txn.set(board.slaveId, MB_FC_READ_INPUT_REGS, MB_REG_BOARD_START + MB_BOARD_CHANGES, 1, rxValues);
+    }
+
+    activeBoard = next;
+    if (!comm->submit(txn)) {
+        activeBoard = -1;
+        if (txn.result != MB_RESULT_QUEUE_FULL) {
+            // Not retryable right now (e.g. port is a server): skip this period
+            board.nextPoll = now + MB_AGG_POLL_PERIOD;
+        }
+        busy = false;
+    }
+}
+
+void ModbusAggregator::onComplete(ModbusTransaction& t) {
+    if (activeBoard >= 0) {
+        Board& board = boards[activeBoard];
+        unsigned long now = millis();
+        bool answered = (t.result == MB_RESULT_SUCCESS);
+
+        portENTER_CRITICAL(&lock);
+        board.online = answered;
+        if (answered && activeWindow) {
+            memcpy(board.window, rxValues, sizeof(board.window));
+            board.changes = rxValues[MB_BOARD_CHANGES];
+            board.valid = true;
+            board.needWindow = false;
+            board.lastWindow = now;
+            board.confirmedAt = now;
+            board.windowReads++;
+        }
+        else if (answered) {
+            if (rxValues[0] == board.changes) {
+                board.confirmedAt = now;
+            } else {
+                board.needWindow = true;
+            }
+        }
+        portEXIT_CRITICAL(&lock);
+
+        // A moved counter is followed by the window straight away
+        board.nextPoll = (answered && board.needWindow) ? now : now + MB_AGG_POLL_PERIOD;
+        activeBoard = -1;
+    }
+
+    // Keep the bus busy with the next due board
+    busy = false;
+    submitNext();
+}
+
+uint8_t ModbusAggregator::handleRegisters(ModbusBlock& block) {
+    if (block.write) {
+        return MB_EX_ILLEGAL_FUNCTION;
+    }
+
+    unsigned long now = millis();
+
+    portENTER_CRITICAL(&lock);
+    for (uint16_t i = 0; i < block.count; i++) {
+        uint16_t reg = block.offset + i;
+        const Board& board = boards[reg / MB_AGG_STRIDE];
+        uint16_t field = reg % MB_AGG_STRIDE;
+
+        switch (field) {
+            case 0:
+                block.values[i] = (board.online ? MB_AGG_LINK_ONLINE : 0) | (board.valid ? MB_AGG_LINK_VALID : 0);
+                break;
+            case 1: {
+                unsigned long age = now - board.confirmedAt;
+                block.values[i] = (!board.valid || age > 0xFFFF) ? 0xFFFF : age;
+                break;
+            }
+            case 2:
+                block.values[i] = board.slaveId;
+                break;
+            case 3:
+                block.values[i] = board.windowReads;
+                break;
+            default:
+                field -= MB_AGG_HEADER;
+                block.values[i] = (field < MB_BOARD_WINDOW_SIZE) ? board.window[field] : 0;
+                break;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+
+    return MB_EX_NONE;
+}
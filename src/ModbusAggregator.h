@@ -0,0 +1,78 @@
+/**
+ * ModbusAggregator.h - Board aggregator for Cortex Link A8R-M ESP32 IoT Smart Home Controller
+ *
+ * Polls other A8R-M boards on the RS485 segment through ModbusComm's
+ * asynchronous master and republishes their board windows as local input
+ * registers (layout in Config.h), so SCADA polls one device instead of N.
+ * Every MB_AGG_POLL_PERIOD ms a board is asked for its change counter
+ * (one register, MB_BOARD_CHANGES). Only when the counter has moved, or
+ * every MB_AGG_REFRESH_PERIOD ms, is its whole window transferred. The
+ * polled boards must run firmware with the change counter.
+ */
+
+#ifndef MODBUS_AGGREGATOR_H
+#define MODBUS_AGGREGATOR_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "ModbusComm.h"
+
+static_assert(MB_AGG_HEADER + MB_BOARD_WINDOW_SIZE <= MB_AGG_STRIDE, "MB_AGG_STRIDE too small for a board window");
+static_assert(MB_AGG_REG_START + MB_AGG_MAX_BOARDS * MB_AGG_STRIDE <= MB_SERVER_REG_SPACE,
+              "Aggregator registers outside the server space");
+
+class ModbusAggregator {
+public:
+    ModbusAggregator();
+
+    /**
+     * Attach to the Modbus master and register the republished range
+     * @param comm ModbusComm instance running in master mode
+     * @return false if MB_AGG_BOARDS is empty or the range was refused
+     */
+    bool begin(ModbusComm& comm);
+
+    /**
+     * Submit the next due read (call this in the loop). Completed reads
+     * chain the next one, so the bus stays busy between calls.
+     */
+    void task();
+
+    uint8_t getBoardCount() const { return boardCount; }
+
+    /**
+     * Whether the last request to a board was answered
+     */
+    bool isOnline(uint8_t board) const { return board < boardCount && boards[board].online; }
+
+private:
+    struct Board {
+        uint8_t slaveId;
+        bool online;
+        bool valid;                  // Window copied at least once
+        bool needWindow;             // Change counter moved since the copy
+        uint16_t changes;            // Change counter of the copy
+        uint16_t windowReads;
+        unsigned long nextPoll;
+        unsigned long lastWindow;    // millis() of the last full transfer
+        unsigned long confirmedAt;   // millis() the copy was last known current
+        uint16_t window[MB_BOARD_WINDOW_SIZE];
+    };
+
+    ModbusComm* comm;
+    Board boards[MB_AGG_MAX_BOARDS];
+    uint8_t boardCount;
+
+    ModbusTransaction txn;
+    uint16_t rxValues[MB_BOARD_WINDOW_SIZE];
+    int8_t activeBoard;
+    bool activeWindow;
+    bool busy;                       // A read is being submitted or on the bus
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    void submitNext();
+    void onComplete(ModbusTransaction& t);
+    uint8_t handleRegisters(ModbusBlock& block);
+};
+
+#endif // MODBUS_AGGREGATOR_H
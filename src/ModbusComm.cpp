@@ -1,156 +1,678 @@
-#include "ModbusComm.h"
-#include <Arduino.h>
-
-ModbusComm::ModbusComm() : baudRate(9600), mbServerEnabled(false) {
-    serialPort = &Serial2;
-}
-
-bool ModbusComm::begin(unsigned long baud) {
-    baudRate = baud;
-    
-    // Configure MAX485 control pin
-    pinMode(PIN_MAX485_TXRX, OUTPUT);
-    digitalWrite(PIN_MAX485_TXRX, LOW);  // Set to receive mode by default
-    
-    // Start serial port for RS485
-    serialPort->begin(baudRate, SERIAL_8N1, PIN_MAX485_RO, PIN_MAX485_DI);
-    
-    // Initialize Modbus RTU with Serial2
-    mb.begin(serialPort, PIN_MAX485_TXRX);
-    mb.master();  // Set as master by default
-    
-    return true;
-}
-
-bool ModbusComm::readRegisters(uint8_t slaveAddr, uint16_t regAddr, uint16_t numRegs, uint16_t* data) {
-    // Use modbus-esp8266 to read holding registers
-    mb.readHreg(slaveAddr, regAddr, data, numRegs);
-    
-    // Process any pending communications (timeout set to 1000ms)
-    uint32_t startTime = millis();
-    while (millis() - startTime < 1000) {
-        mb.task();
-        delay(1);  // Small delay to prevent CPU hogging
-    }
-    
-    return true;
-}
-
-bool ModbusComm::writeRegister(uint8_t slaveAddr, uint16_t regAddr, uint16_t value) {
-    // Write single register
-    mb.writeHreg(slaveAddr, regAddr, value);
-    
-    // Process any pending communications (timeout set to 1000ms)
-    uint32_t startTime = millis();
-    while (millis() - startTime < 1000) {
-        mb.task();
-        delay(1);  // Small delay to prevent CPU hogging
-    }
-    
-    return true;
-}
-
-bool ModbusComm::writeMultipleRegisters(uint8_t slaveAddr, uint16_t regAddr, uint16_t* data, uint16_t numRegs) {
-    // Write multiple registers
-    mb.writeHreg(slaveAddr, regAddr, data, numRegs);
-    
-    // Process any pending communications (timeout set to 1000ms)
-    uint32_t startTime = millis();
-    while (millis() - startTime < 1000) {
-        mb.task();
-        delay(1);  // Small delay to prevent CPU hogging
-    }
-    
-    return true;
-}
-
-void ModbusComm::task() {
-    // Process Modbus messages
-    mb.task();
-}
-
-bool ModbusComm::addHoldingRegisterHandler(uint16_t regAddr, uint16_t numRegs, cbModbus cb) {
-    // If not already in server mode, switch to server mode
-    if (!mbServerEnabled) {
-        mb.server(1); // Default slave ID = 1
-        mbServerEnabled = true;
-    }
-    
-    // Add holding register handler
-    bool result = false;
-    for (uint16_t i = 0; i < numRegs; i++) {
-        result = mb.addHreg(regAddr + i, 0);
-        if (!result) break;
-    }
-    
-    if (result) {
-        mb.onGetHreg(regAddr, cb, numRegs);
-        mb.onSetHreg(regAddr, cb, numRegs);
-    }
-    
-    return result;
-}
-
-bool ModbusComm::addInputRegisterHandler(uint16_t regAddr, uint16_t numRegs, cbModbus cb) {
-    // If not already in server mode, switch to server mode
-    if (!mbServerEnabled) {
-        mb.server(1); // Default slave ID = 1
-        mbServerEnabled = true;
-    }
-    
-    // Add input register handler
-    bool result = false;
-    for (uint16_t i = 0; i < numRegs; i++) {
-        result = mb.addIreg(regAddr + i, 0);
-        if (!result) break;
-    }
-    
-    if (result) {
-        mb.onGetIreg(regAddr, cb, numRegs);
-    }
-    
-    return result;
-}
-
-bool ModbusComm::addCoilHandler(uint16_t regAddr, uint16_t numCoils, cbModbus cb) {
-    // If not already in server mode, switch to server mode
-    if (!mbServerEnabled) {
-        mb.server(1); // Default slave ID = 1
-        mbServerEnabled = true;
-    }
-    
-    // Add coil handler
-    bool result = false;
-    for (uint16_t i = 0; i < numCoils; i++) {
-        result = mb.addCoil(regAddr + i, false);
-        if (!result) break;
-    }
-    
-    if (result) {
-        mb.onGetCoil(regAddr, cb, numCoils);
-        mb.onSetCoil(regAddr, cb, numCoils);
-    }
-    
-    return result;
-}
-
-bool ModbusComm::addDiscreteInputHandler(uint16_t regAddr, uint16_t numInputs, cbModbus cb) {
-    // If not already in server mode, switch to server mode
-    if (!mbServerEnabled) {
-        mb.server(1); // Default slave ID = 1
-        mbServerEnabled = true;
-    }
-    
-    // Add discrete input handler
-    bool result = false;
-    for (uint16_t i = 0; i < numInputs; i++) {
-        result = mb.addIsts(regAddr + i, false);
-        if (!result) break;
-    }
-    
-    if (result) {
-        mb.onGetIsts(regAddr, cb, numInputs);
-    }
-    
-    return result;
+#include "ModbusComm.h"
+#include <Arduino.h>
+#ifdef MODBUS_BENCHMARK
+#include "Debug.h"
+#endif
+
+ModbusTransaction::ModbusTransaction() :
+    slaveId(0),
+    function(0),
+    address(0),
+    count(0),
+    data(nullptr),
+    timeoutMs(0),
+    probe(false),
+    result(MB_RESULT_IDLE),
+    exceptionCode(0),
+    attempts(0),
+    retryAt(0),
+    latencyMicros(0)
+{
+}
+
+void ModbusTransaction::set(uint8_t slave, uint8_t fc, uint16_t addr, uint16_t num,
+                            uint16_t* buffer, uint16_t timeout) {
+    slaveId = slave;
+    function = fc;
+    address = addr;
+    count = num;
+    data = buffer;
+    timeoutMs = timeout;
+    result = MB_RESULT_IDLE;
+    exceptionCode = 0;
+    attempts = 0;
+}
+
+ModbusComm::ModbusComm() :
+    port(Serial2),
+    taskHandle(nullptr),
+    mutex(nullptr),
+    overrunsSeen(0),
+    baudRate(9600),
+    mbServerEnabled(false),
+    masterModeLocked(false),
+    rxLength(0),
+    queueHead(0),
+    queueCount(0),
+    activeTxn(nullptr),
+    expectedLength(0),
+    sentAt(0),
+    replyTimeout(0),
+    lastResult(MB_RESULT_IDLE),
+    lastException(0)
+{
+#ifdef MODBUS_BENCHMARK
+    latencyCount = 0;
+    latencyMin = 0xFFFFFFFF;
+    latencyMax = 0;
+    latencySum = 0;
+    requestAllocations = 0;
+#endif
+}
+
+bool ModbusComm::begin(unsigned long baud) {
+    baudRate = baud;
+
+    // UART in RS485 mode: MAX485 direction and end of frame are handled in hardware
+    bool ok = port.begin(baudRate, PIN_MAX485_RO, PIN_MAX485_DI, PIN_MAX485_TXRX);
+
+#ifdef MODBUS_BENCHMARK
+    // Requests are served from loop() until startTask()
+    Debug::countAllocations(xTaskGetCurrentTaskHandle());
+#endif
+
+    // Master by default, adding a server handler switches to server mode
+    return ok;
+}
+
+bool ModbusComm::setBaudRate(unsigned long baud) {
+    if (baud == 0) {
+        return false;
+    }
+
+    lock();
+    bool idle = !mbServerEnabled && activeTxn == nullptr && queueCount == 0;
+    if (idle) {
+        baudRate = baud;
+        port.setBaudRate(baud);
+    }
+    unlock();
+
+    return idle;
+}
+
+bool ModbusComm::startTask(BaseType_t core, UBaseType_t priority) {
+    if (taskHandle != nullptr) {
+        return true;
+    }
+
+    // Callbacks may submit follow-up requests while the queue is held
+    mutex = xSemaphoreCreateRecursiveMutex();
+    if (mutex == nullptr) {
+        return false;
+    }
+
+    if (xTaskCreatePinnedToCore(taskLoop, "modbus", MB_TASK_STACK, this, priority,
+                                &taskHandle, core) != pdPASS) {
+        taskHandle = nullptr;
+        return false;
+    }
+
+    port.setNotifyTask(taskHandle);
+#ifdef MODBUS_BENCHMARK
+    Debug::countAllocations(taskHandle);
+#endif
+    return true;
+}
+
+void ModbusComm::taskLoop(void* arg) {
+    ModbusComm* comm = static_cast<ModbusComm*>(arg);
+
+    for (;;) {
+        // A server only has work after a frame end. A master also needs a
+        // tick for reply timeouts and the gap before its next request.
+        bool masterBusy = !comm->mbServerEnabled &&
+                          (comm->activeTxn != nullptr || comm->queueCount > 0);
+        ulTaskNotifyTake(pdTRUE, masterBusy ? 1 : portMAX_DELAY);
+
+        comm->lock();
+        comm->process();
+        comm->unlock();
+    }
+}
+
+void ModbusComm::lock() {
+    if (mutex != nullptr) {
+        xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    }
+}
+
+void ModbusComm::unlock() {
+    if (mutex != nullptr) {
+        xSemaphoreGiveRecursive(mutex);
+    }
+}
+
+bool ModbusComm::submit(ModbusTransaction& txn) {
+    if (mbServerEnabled) {
+        txn.result = MB_RESULT_NOT_MASTER;
+        return false;
+    }
+
+    // Validate function code, quantity limits and buffer
+    uint16_t maxCount = 0;
+    bool isWrite = false;
+    switch (txn.function) {
+        case MB_FC_READ_COILS:
+        case MB_FC_READ_DISCRETE_INPUTS:
+            maxCount = 2000;
+            break;
+        case MB_FC_READ_HOLDING_REGS:
+        case MB_FC_READ_INPUT_REGS:
+            maxCount = 125;
+            break;
+        case MB_FC_WRITE_SINGLE_COIL:
+        case MB_FC_WRITE_SINGLE_REG:
+            maxCount = 1;
+            isWrite = true;
+            break;
+        case MB_FC_WRITE_MULTIPLE_COILS:
+            maxCount = 1968;
+            isWrite = true;
+            break;
+        case MB_FC_WRITE_MULTIPLE_REGS:
+            maxCount = 123;
+            isWrite = true;
+            break;
+    }
+
+    if (maxCount == 0 || txn.count == 0 || txn.count > maxCount || txn.data == nullptr ||
+        txn.slaveId > 247 || (txn.slaveId == 0 && !isWrite)) {
+        txn.result = MB_RESULT_INVALID_REQUEST;
+        return false;
+    }
+
+    lock();
+    if (queueCount >= MB_MASTER_QUEUE_SIZE) {
+        unlock();
+        txn.result = MB_RESULT_QUEUE_FULL;
+        return false;
+    }
+
+    txn.result = MB_RESULT_PENDING;
+    txn.exceptionCode = 0;
+    txn.attempts = 0;
+    queue[(queueHead + queueCount) % MB_MASTER_QUEUE_SIZE] = &txn;
+    queueCount++;
+    unlock();
+
+    if (taskHandle != nullptr) {
+        xTaskNotifyGive(taskHandle);
+    }
+
+    return true;
+}
+
+bool ModbusComm::transact(uint8_t slaveAddr, uint8_t function, uint16_t addr, uint16_t count, uint16_t* data) {
+    ModbusTransaction txn;
+    txn.set(slaveAddr, function, addr, count, data);
+
+    if (submit(txn)) {
+        // Wait only as long as this request (and any queued ahead of it) takes
+        while (!txn.isDone()) {
+            task();
+            delay(1);
+        }
+    }
+
+    lastResult = txn.result;
+    lastException = txn.exceptionCode;
+    return lastResult == MB_RESULT_SUCCESS;
+}
+
+bool ModbusComm::readCoils(uint8_t slaveAddr, uint16_t coilAddr, uint16_t numCoils, uint16_t* data) {
+    return transact(slaveAddr, MB_FC_READ_COILS, coilAddr, numCoils, data);
+}
+
+bool ModbusComm::readDiscreteInputs(uint8_t slaveAddr, uint16_t inputAddr, uint16_t numInputs, uint16_t* data) {
+    return transact(slaveAddr, MB_FC_READ_DISCRETE_INPUTS, inputAddr, numInputs, data);
+}
+
+bool ModbusComm::readInputRegisters(uint8_t slaveAddr, uint16_t regAddr, uint16_t numRegs, uint16_t* data) {
+    return transact(slaveAddr, MB_FC_READ_INPUT_REGS, regAddr, numRegs, data);
+}
+
+bool ModbusComm::readRegisters(uint8_t slaveAddr, uint16_t regAddr, uint16_t numRegs, uint16_t* data) {
+    return transact(slaveAddr, MB_FC_READ_HOLDING_REGS, regAddr, numRegs, data);
+}
+
+bool ModbusComm::writeRegister(uint8_t slaveAddr, uint16_t regAddr, uint16_t value) {
+    return transact(slaveAddr, MB_FC_WRITE_SINGLE_REG, regAddr, 1, &value);
+}
+
+bool ModbusComm::writeMultipleRegisters(uint8_t slaveAddr, uint16_t regAddr, uint16_t* data, uint16_t numRegs) {
+    return transact(slaveAddr, MB_FC_WRITE_MULTIPLE_REGS, regAddr, numRegs, data);
+}
+
+void ModbusComm::task() {
+    // The dedicated task does the work once it runs
+    if (taskHandle == nullptr) {
+        process();
+    }
+}
+
+void ModbusComm::process() {
+    uint32_t overruns = port.getOverrunCount();
+    if (overruns != overrunsSeen) {
+        diagnostics.countServer(MB_DIAG_CHAR_OVERRUNS, overruns - overrunsSeen);
+        overrunsSeen = overruns;
+    }
+
+    if (mbServerEnabled) {
+        serverTask();
+    } else {
+        masterTask();
+    }
+}
+
+void ModbusComm::serverTask() {
+    // The UART reports the end of the frame after the inter-frame gap. Take
+    // the event before reading, its bytes are already in the ring buffer.
+    bool frameEnd = port.takeFrameEnd();
+    rxLength += port.read(&rxFrame[rxLength], MB_RTU_MAX_FRAME - rxLength);
+
+    if (!frameEnd || rxLength == 0) {
+        return;
+    }
+
+#ifdef MODBUS_BENCHMARK
+    // Any allocation here would be heap churn on every request
+    uint32_t allocations = Debug::getAllocationCount();
+    handleServerFrame();
+    requestAllocations += Debug::getAllocationCount() - allocations;
+#else
+    handleServerFrame();
+#endif
+    rxLength = 0;
+}
+
+void ModbusComm::handleServerFrame() {
+    diagnostics.countServer(MB_DIAG_BUS_MESSAGES);
+
+    // Runt frames and CRC errors
+    if (!ModbusFrame::check(rxFrame, rxLength)) {
+        diagnostics.countServer(MB_DIAG_BUS_COMM_ERRORS);
+        return;
+    }
+
+    uint8_t unitId = rxFrame[0];
+    if (unitId != MB_SERVER_ID && unitId != 0) {
+        return;  // Addressed to another slave
+    }
+
+    diagnostics.countServer(MB_DIAG_SERVER_MESSAGES);
+
+    // FC08 is a serial line function, answered here rather than by the shared core
+    uint16_t length;
+    if (rxFrame[1] == MB_FC_DIAGNOSTICS) {
+        length = diagnostics.processRequest(&rxFrame[1], rxLength - 3, &txFrame[1]);
+    }
+    else {
+        length = server.processPdu(&rxFrame[1], rxLength - 3, &txFrame[1]);
+    }
+
+    // Broadcasts are executed but never answered
+    if (unitId == 0 || length == 0) {
+        diagnostics.countServer(MB_DIAG_SERVER_NO_RESPONSE);
+        return;
+    }
+
+    if (txFrame[1] & 0x80) {
+        diagnostics.countServer(MB_DIAG_BUS_EXCEPTIONS);
+    }
+
+    sendFrame(ModbusFrame::encode(txFrame, MB_SERVER_ID, &txFrame[1], length));
+
+#ifdef MODBUS_BENCHMARK
+    uint32_t latency = micros() - port.getFrameEndMicros();
+    latencyCount++;
+    latencySum += latency;
+    if (latency < latencyMin) {
+        latencyMin = latency;
+    }
+    if (latency > latencyMax) {
+        latencyMax = latency;
+    }
+#endif
+}
+
+#ifdef MODBUS_BENCHMARK
+void ModbusComm::printLatency(Print& out) {
+    if (latencyCount == 0) {
+        out.println("Modbus RTU latency: no requests");
+        return;
+    }
+
+    out.printf("Modbus RTU latency (%s): n=%lu min=%lu avg=%lu max=%lu us, %lu allocations\n",
+               (taskHandle != nullptr) ? "task" : "loop", (unsigned long)latencyCount,
+               (unsigned long)latencyMin, (unsigned long)(latencySum / latencyCount),
+               (unsigned long)latencyMax, (unsigned long)requestAllocations);
+
+    latencyCount = 0;
+    latencyMin = 0xFFFFFFFF;
+    latencyMax = 0;
+    latencySum = 0;
+    requestAllocations = 0;
+}
+#endif
+
+void ModbusComm::sendFrame(uint16_t length) {
+    // The UART asserts DE for the duration of the frame
+    port.write(txFrame, length);
+}
+
+void ModbusComm::masterTask() {
+    if (activeTxn == nullptr) {
+        // Drop stray bytes so they cannot prefix the next reply
+        port.discard();
+
+        // Start the next request once the bus has been quiet for 3.5 characters,
+        // skipping retries that are still backing off
+        if (queueCount > 0 && port.isBusIdle()) {
+            for (uint8_t i = 0; i < queueCount; i++) {
+                ModbusTransaction* txn = queue[(queueHead + i) % MB_MASTER_QUEUE_SIZE];
+                if (txn->attempts > 0 && (long)(millis() - txn->retryAt) < 0) {
+                    continue;
+                }
+
+                takeQueued(i);
+                if (txn->slaveId != 0 && !txn->probe && !slaveHealth.admit(txn->slaveId)) {
+                    // Offline slave between probes: fail without using the bus
+                    completeTransaction(txn, MB_RESULT_SLAVE_OFFLINE);
+                } else {
+                    startTransaction(txn);
+                }
+                break;
+            }
+        }
+        return;
+    }
+
+    // Broadcast writes get no reply, only the turnaround delay
+    if (activeTxn->slaveId == 0) {
+        if ((long)(millis() - sentAt) >= MB_MASTER_TURNAROUND_DELAY) {
+            finishTransaction(MB_RESULT_SUCCESS);
+        }
+        return;
+    }
+
+    // Collect reply bytes
+    bool frameEnd = port.takeFrameEnd();
+    rxLength += port.read(&rxFrame[rxLength], MB_RTU_MAX_FRAME - rxLength);
+
+    // Exception replies are always 5 bytes long
+    if (rxLength >= 2 && rxFrame[1] == (activeTxn->function | 0x80)) {
+        expectedLength = 5;
+    }
+
+    if (rxLength >= expectedLength) {
+        // Complete frame: report it immediately
+        rxLength = expectedLength;
+        finishTransaction(parseResponse(activeTxn));
+    }
+    else if (rxLength > 0 && frameEnd) {
+        // The slave stopped sending before the frame was complete
+        finishTransaction(parseResponse(activeTxn));
+    }
+    else {
+        if ((long)(millis() - sentAt) >= (long)replyTimeout) {
+            finishTransaction(MB_RESULT_TIMEOUT);
+        }
+    }
+}
+
+bool ModbusComm::startTransaction(ModbusTransaction* txn) {
+    uint16_t length = buildRequest(txn);
+
+    activeTxn = txn;
+    rxLength = 0;
+    expectedLength = expectedReplyLength(txn);
+    txn->attempts++;
+    replyTimeout = txn->timeoutMs ? txn->timeoutMs :
+                   slaveHealth.timeoutFor(txn->slaveId, expectedLength * port.getCharMicros());
+
+    sendFrame(length);
+
+    // The reply timeout starts when the last byte has left the wire. If
+    // the task was preempted past that point the frame is already out.
+    long remaining = (long)(port.getTxDoneMicros() - micros());
+    if (remaining < 0) {
+        remaining = 0;
+    }
+    sentAt = millis() + remaining / 1000;
+
+    return true;
+}
+
+void ModbusComm::finishTransaction(ModbusResult result) {
+    ModbusTransaction* txn = activeTxn;
+
+    // Release the bus first so the callback can queue a follow-up request
+    uint16_t replyLength = rxLength;
+    activeTxn = nullptr;
+    rxLength = 0;
+
+    uint32_t roundTrip = micros() - port.getTxDoneMicros();
+    if (txn->slaveId != 0) {
+        // Latency without the reply's own transmission time
+        uint32_t replyMicros = replyLength * port.getCharMicros();
+        txn->latencyMicros = (roundTrip > replyMicros) ? roundTrip - replyMicros : 1;
+    }
+
+    if (txn->slaveId != 0 && !txn->probe) {
+        diagnostics.recordMaster(txn->slaveId, result, roundTrip);
+
+        if (result == MB_RESULT_SUCCESS || result == MB_RESULT_EXCEPTION) {
+            // A retried request's reply may belong to an earlier attempt,
+            // so it gives no sample (as Karn's algorithm in TCP)
+            slaveHealth.recordReply(txn->slaveId, (txn->attempts > 1) ? 0 : txn->latencyMicros);
+        }
+        else {
+            // Requests with their own timeout and probes of an offline
+            // slave are not retried
+            if (txn->timeoutMs == 0 && txn->attempts <= MB_MASTER_RETRIES &&
+                !slaveHealth.isOffline(txn->slaveId) && requeue(txn)) {
+                return;
+            }
+            slaveHealth.recordFailure(txn->slaveId);
+        }
+    }
+
+    completeTransaction(txn, result);
+}
+
+void ModbusComm::completeTransaction(ModbusTransaction* txn, ModbusResult result) {
+    txn->result = result;
+    if (txn->callback) {
+        txn->callback(*txn);
+    }
+}
+
+ModbusTransaction* ModbusComm::takeQueued(uint8_t pos) {
+    ModbusTransaction* txn = queue[(queueHead + pos) % MB_MASTER_QUEUE_SIZE];
+
+    if (pos == 0) {
+        queueHead = (queueHead + 1) % MB_MASTER_QUEUE_SIZE;
+    } else {
+        for (uint8_t i = pos; i + 1 < queueCount; i++) {
+            queue[(queueHead + i) % MB_MASTER_QUEUE_SIZE] = queue[(queueHead + i + 1) % MB_MASTER_QUEUE_SIZE];
+        }
+    }
+    queueCount--;
+
+    return txn;
+}
+
+// Put a failed request back at the end of the queue, so other slaves are
+// served during its backoff
+bool ModbusComm::requeue(ModbusTransaction* txn) {
+    if (queueCount >= MB_MASTER_QUEUE_SIZE) {
+        return false;
+    }
+
+    txn->retryAt = millis() + ((uint32_t)MB_MASTER_RETRY_BACKOFF << (txn->attempts - 1));
+    queue[(queueHead + queueCount) % MB_MASTER_QUEUE_SIZE] = txn;
+    queueCount++;
+
+    return true;
+}
+
+uint16_t ModbusComm::buildRequest(const ModbusTransaction* txn) {
+    uint16_t length = 0;
+    txFrame[length++] = txn->slaveId;
+    txFrame[length++] = txn->function;
+    txFrame[length++] = txn->address >> 8;
+    txFrame[length++] = txn->address & 0xFF;
+
+    switch (txn->function) {
+        case MB_FC_WRITE_SINGLE_COIL:
+            txFrame[length++] = txn->data[0] ? 0xFF : 0x00;
+            txFrame[length++] = 0x00;
+            break;
+
+        case MB_FC_WRITE_SINGLE_REG:
+            txFrame[length++] = txn->data[0] >> 8;
+            txFrame[length++] = txn->data[0] & 0xFF;
+            break;
+
+        case MB_FC_WRITE_MULTIPLE_COILS: {
+            uint8_t byteCount = (txn->count + 7) / 8;
+            txFrame[length++] = txn->count >> 8;
+            txFrame[length++] = txn->count & 0xFF;
+            txFrame[length++] = byteCount;
+            memset(&txFrame[length], 0, byteCount);
+            for (uint16_t i = 0; i < txn->count; i++) {
+                if (txn->data[i]) {
+                    txFrame[length + i / 8] |= 1 << (i % 8);
+                }
+            }
+            length += byteCount;
+            break;
+        }
+
+        case MB_FC_WRITE_MULTIPLE_REGS:
+            txFrame[length++] = txn->count >> 8;
+            txFrame[length++] = txn->count & 0xFF;
+            txFrame[length++] = txn->count * 2;
+            for (uint16_t i = 0; i < txn->count; i++) {
+                txFrame[length++] = txn->data[i] >> 8;
+                txFrame[length++] = txn->data[i] & 0xFF;
+            }
+            break;
+
+        default:
+            // Read functions: quantity only
+            txFrame[length++] = txn->count >> 8;
+            txFrame[length++] = txn->count & 0xFF;
+            break;
+    }
+
+    return ModbusFrame::seal(txFrame, length);
+}
+
+uint16_t ModbusComm::expectedReplyLength(const ModbusTransaction* txn) const {
+    switch (txn->function) {
+        case MB_FC_READ_COILS:
+        case MB_FC_READ_DISCRETE_INPUTS:
+            return 5 + (txn->count + 7) / 8;
+        case MB_FC_READ_HOLDING_REGS:
+        case MB_FC_READ_INPUT_REGS:
+            return 5 + txn->count * 2;
+        default:
+            // Write functions echo address and value/quantity
+            return 8;
+    }
+}
+
+ModbusResult ModbusComm::parseResponse(ModbusTransaction* txn) {
+    if (rxLength < 5) {
+        return MB_RESULT_INVALID_RESPONSE;
+    }
+
+    if (!ModbusFrame::check(rxFrame, rxLength)) {
+        return MB_RESULT_CRC_ERROR;
+    }
+
+    if (rxFrame[0] != txn->slaveId) {
+        return MB_RESULT_INVALID_RESPONSE;
+    }
+
+    if (rxFrame[1] == (txn->function | 0x80) && rxLength == 5) {
+        txn->exceptionCode = rxFrame[2];
+        return MB_RESULT_EXCEPTION;
+    }
+
+    if (rxFrame[1] != txn->function || rxLength != expectedReplyLength(txn)) {
+        return MB_RESULT_INVALID_RESPONSE;
+    }
+
+    switch (txn->function) {
+        case MB_FC_READ_COILS:
+        case MB_FC_READ_DISCRETE_INPUTS:
+            if (rxFrame[2] != (txn->count + 7) / 8) {
+                return MB_RESULT_INVALID_RESPONSE;
+            }
+            for (uint16_t i = 0; i < txn->count; i++) {
+                txn->data[i] = (rxFrame[3 + i / 8] >> (i % 8)) & 0x01;
+            }
+            break;
+
+        case MB_FC_READ_HOLDING_REGS:
+        case MB_FC_READ_INPUT_REGS:
+            if (rxFrame[2] != txn->count * 2) {
+                return MB_RESULT_INVALID_RESPONSE;
+            }
+            for (uint16_t i = 0; i < txn->count; i++) {
+                txn->data[i] = (rxFrame[3 + i * 2] << 8) | rxFrame[4 + i * 2];
+            }
+            break;
+
+        default:
+            // Write replies must echo the request header
+            if (memcmp(&rxFrame[2], &txFrame[2], 4) != 0) {
+                return MB_RESULT_INVALID_RESPONSE;
+            }
+            break;
+    }
+
+    return MB_RESULT_SUCCESS;
+}
+
+void ModbusComm::enableServer() {
+    if (!mbServerEnabled && !masterModeLocked) {
+        mbServerEnabled = true;
+        rxLength = 0;
+    }
+}
+
+void ModbusComm::setMasterMode(bool enabled) {
+    masterModeLocked = enabled;
+    mbServerEnabled = !enabled;
+    rxLength = 0;
+}
+
+bool ModbusComm::addHoldingRegisterHandler(uint16_t regAddr, uint16_t numRegs, cbModbus cb) {
+    // If not already in server mode, switch to server mode
+    enableServer();
+    return server.addHandler(MB_HOLDING_REG, regAddr, numRegs, cb);
+}
+
+bool ModbusComm::addInputRegisterHandler(uint16_t regAddr, uint16_t numRegs, cbModbus cb) {
+    enableServer();
+    return server.addHandler(MB_INPUT_REG, regAddr, numRegs, cb);
+}
+
+bool ModbusComm::addCoilHandler(uint16_t regAddr, uint16_t numCoils, cbModbus cb) {
+    enableServer();
+    return server.addHandler(MB_COIL, regAddr, numCoils, cb);
+}
+
+bool ModbusComm::addDiscreteInputHandler(uint16_t regAddr, uint16_t numInputs, cbModbus cb) {
+    enableServer();
+    return server.addHandler(MB_DISCRETE_INPUT, regAddr, numInputs, cb);
+}
+
+bool ModbusComm::addFileHandler(uint16_t fileNum, cbModbusFile cb) {
+    enableServer();
+    return server.addFileHandler(fileNum, cb);
 }
\ No newline at end of file
@@ -1,40 +1,168 @@
-#ifndef MODBUS_COMM_H
-#define MODBUS_COMM_H
-
-#include <Arduino.h>
-#include <ModbusRTU.h>
-#include "Config.h"
-
-// Callback function type for Modbus register operations
-typedef std::function<uint16_t(TRegister* reg, uint16_t val)> cbModbus;
-
-class ModbusComm {
-public:
-    ModbusComm();
-    bool begin(unsigned long baudRate = 9600);
-    
-    // Modbus functions
-    bool readRegisters(uint8_t slaveAddr, uint16_t regAddr, uint16_t numRegs, uint16_t* data);
-    bool writeRegister(uint8_t slaveAddr, uint16_t regAddr, uint16_t value);
-    bool writeMultipleRegisters(uint8_t slaveAddr, uint16_t regAddr, uint16_t* data, uint16_t numRegs);
-    
-    // Process Modbus messages
-    void task();
-    
-    // Serial port access for direct communication
-    HardwareSerial* getSerial() { return serialPort; }
-    
-    // Register callback handlers for Modbus server functionality
-    bool addHoldingRegisterHandler(uint16_t regAddr, uint16_t numRegs, cbModbus cb);
-    bool addInputRegisterHandler(uint16_t regAddr, uint16_t numRegs, cbModbus cb);
-    bool addCoilHandler(uint16_t regAddr, uint16_t numCoils, cbModbus cb);
-    bool addDiscreteInputHandler(uint16_t regAddr, uint16_t numInputs, cbModbus cb);
-
-private:
-    ModbusRTU mb;
-    HardwareSerial* serialPort;
-    unsigned long baudRate;
-    bool mbServerEnabled;
-};
-
+#ifndef MODBUS_COMM_H
+#define MODBUS_COMM_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "ModbusDefs.h"
+#include "ModbusServer.h"
+#include "RS485Port.h"
+#include "ModbusDiagnostics.h"
+#include "ModbusFrame.h"
+#include "ModbusSlaveHealth.h"
+
+struct ModbusTransaction;
+
+// Completion callback for master transactions
+typedef std::function<void(ModbusTransaction& txn)> cbModbusTransaction;
+
+// One master request. The caller owns the object and must keep it (and its
+// data buffer) alive while result is MB_RESULT_PENDING.
+struct ModbusTransaction {
+    uint8_t slaveId;
+    uint8_t function;
+    uint16_t address;
+    uint16_t count;
+    uint16_t* data;          // Registers, or one 0/1 entry per coil/input
+    uint16_t timeoutMs;      // 0 = adaptive (see ModbusSlaveHealth), no retries otherwise
+    bool probe;              // Discovery request: kept out of diagnostics and slave health
+    cbModbusTransaction callback;
+
+    // Filled in by ModbusComm
+    volatile ModbusResult result;
+    uint8_t exceptionCode;
+    uint8_t attempts;        // Times sent so far
+    unsigned long retryAt;   // millis() before which a retry waits in the queue
+    uint32_t latencyMicros;  // End of request to start of reply, last attempt
+
+    ModbusTransaction();
+    void set(uint8_t slaveId, uint8_t function, uint16_t address, uint16_t count,
+             uint16_t* data, uint16_t timeoutMs = 0);
+    bool isDone() const { return result != MB_RESULT_PENDING && result != MB_RESULT_IDLE; }
+};
+
+class ModbusComm {
+public:
+    ModbusComm();
+    bool begin(unsigned long baudRate = 9600);
+
+    // Run the port from a dedicated FreeRTOS task woken by UART frame events
+    // and by submit(). task() then does nothing, and master callbacks and
+    // server handlers run in that task.
+    bool startTask(BaseType_t core = MB_TASK_CORE, UBaseType_t priority = MB_TASK_PRIORITY);
+    bool isTaskRunning() const { return taskHandle != nullptr; }
+
+    // Asynchronous master API: the transaction is queued and its result and
+    // callback are set from task() as soon as the reply frame completes
+    bool submit(ModbusTransaction& txn);
+    uint8_t pendingRequests() const { return queueCount + (activeTxn ? 1 : 0); }
+
+    // Blocking master functions - wait only until the reply or the timeout
+    bool readCoils(uint8_t slaveAddr, uint16_t coilAddr, uint16_t numCoils, uint16_t* data);
+    bool readDiscreteInputs(uint8_t slaveAddr, uint16_t inputAddr, uint16_t numInputs, uint16_t* data);
+    bool readInputRegisters(uint8_t slaveAddr, uint16_t regAddr, uint16_t numRegs, uint16_t* data);
+    bool readRegisters(uint8_t slaveAddr, uint16_t regAddr, uint16_t numRegs, uint16_t* data);
+    bool writeRegister(uint8_t slaveAddr, uint16_t regAddr, uint16_t value);
+    bool writeMultipleRegisters(uint8_t slaveAddr, uint16_t regAddr, uint16_t* data, uint16_t numRegs);
+
+    // Outcome of the last blocking call
+    ModbusResult getLastResult() const { return lastResult; }
+    uint8_t getLastException() const { return lastException; }
+
+    // Process Modbus messages (call this in the loop unless startTask() was used)
+    void task();
+
+#ifdef MODBUS_BENCHMARK
+    // Print and reset the RTU server's frame end to response latency and
+    // the heap allocations made while serving the requests
+    void printLatency(Print& out);
+#endif
+
+    // Change the RS485 baud rate. Refused (false) while a request is
+    // queued or on the bus, or in server mode.
+    bool setBaudRate(unsigned long baudRate);
+    unsigned long getBaudRate() const { return baudRate; }
+
+    // Duration of one character at the current baud rate
+    unsigned long getCharMicros() const { return port.getCharMicros(); }
+
+    // Serial port access for direct communication
+    HardwareSerial* getSerial() { return &port.getSerial(); }
+
+    // Register block handlers for Modbus server functionality
+    bool addHoldingRegisterHandler(uint16_t regAddr, uint16_t numRegs, cbModbus cb);
+    bool addInputRegisterHandler(uint16_t regAddr, uint16_t numRegs, cbModbus cb);
+    bool addCoilHandler(uint16_t regAddr, uint16_t numCoils, cbModbus cb);
+    bool addDiscreteInputHandler(uint16_t regAddr, uint16_t numInputs, cbModbus cb);
+    bool addFileHandler(uint16_t fileNum, cbModbusFile cb);
+
+    // Server core, shared by every transport
+    ModbusServer& getServer() { return server; }
+
+    // FC08 counters and per-slave master statistics of the RS485 port
+    ModbusDiagnostics& getDiagnostics() { return diagnostics; }
+
+    // Per-slave reply timing, adaptive timeouts and offline slaves
+    const ModbusSlaveHealth& getSlaveHealth() const { return slaveHealth; }
+
+    // Keep the RS485 port a master even with server handlers registered
+    // (gateway mode). The handlers are then only served over TCP.
+    void setMasterMode(bool enabled);
+
+private:
+    ModbusServer server;
+    RS485Port port;
+    TaskHandle_t taskHandle;
+    SemaphoreHandle_t mutex;         // Guards the master queue while the task runs
+    ModbusDiagnostics diagnostics;
+    ModbusSlaveHealth slaveHealth;
+    uint32_t overrunsSeen;           // Port overruns already counted
+    unsigned long baudRate;
+    bool mbServerEnabled;
+    bool masterModeLocked;
+
+    // RTU framing, shared by master and server mode
+    uint8_t txFrame[MB_RTU_MAX_FRAME];
+    uint8_t rxFrame[MB_RTU_MAX_FRAME];
+    uint16_t rxLength;
+
+    // Master transaction engine
+    ModbusTransaction* queue[MB_MASTER_QUEUE_SIZE];
+    uint8_t queueHead;
+    uint8_t queueCount;
+    ModbusTransaction* activeTxn;
+    uint16_t expectedLength;
+    unsigned long sentAt;            // millis() when the request leaves the wire
+    uint16_t replyTimeout;           // ms after sentAt
+    ModbusResult lastResult;
+    uint8_t lastException;
+
+#ifdef MODBUS_BENCHMARK
+    uint32_t latencyCount;
+    uint32_t latencyMin;
+    uint32_t latencyMax;
+    uint64_t latencySum;
+    uint32_t requestAllocations;     // operator new calls while serving requests
+#endif
+
+    static void taskLoop(void* arg);
+    void process();
+    void lock();
+    void unlock();
+    void serverTask();
+    void handleServerFrame();
+    void enableServer();
+    void sendFrame(uint16_t length);
+
+    void masterTask();
+    bool startTransaction(ModbusTransaction* txn);
+    void finishTransaction(ModbusResult result);
+    void completeTransaction(ModbusTransaction* txn, ModbusResult result);
+    ModbusTransaction* takeQueued(uint8_t pos);
+    bool requeue(ModbusTransaction* txn);
+    uint16_t buildRequest(const ModbusTransaction* txn);
+    ModbusResult parseResponse(ModbusTransaction* txn);
+    uint16_t expectedReplyLength(const ModbusTransaction* txn) const;
+    bool transact(uint8_t slaveAddr, uint8_t function, uint16_t addr, uint16_t count, uint16_t* data);
+};
+
 #endif // MODBUS_COMM_H
\ No newline at end of file
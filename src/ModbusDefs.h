@@ -0,0 +1,61 @@
+/**
+ * ModbusDefs.h - Modbus protocol constants shared by the master and server
+ */
+
+#ifndef MODBUS_DEFS_H
+#define MODBUS_DEFS_H
+
+#include <Arduino.h>
+
+// Function codes
+#define MB_FC_READ_COILS            0x01
+#define MB_FC_READ_DISCRETE_INPUTS  0x02
+#define MB_FC_READ_HOLDING_REGS     0x03
+#define MB_FC_READ_INPUT_REGS       0x04
+#define MB_FC_WRITE_SINGLE_COIL     0x05
+#define MB_FC_WRITE_SINGLE_REG      0x06
+#define MB_FC_DIAGNOSTICS           0x08   // Serial line only
+#define MB_FC_WRITE_MULTIPLE_COILS  0x0F
+#define MB_FC_WRITE_MULTIPLE_REGS   0x10
+#define MB_FC_READ_FILE_RECORD      0x14
+#define MB_FC_WRITE_FILE_RECORD     0x15
+#define MB_FILE_REF_TYPE            0x06   // Reference type of every file sub-request
+#define MB_FILE_MAX_RECORD          9999   // Highest record number in a file
+
+// Exception codes
+#define MB_EX_NONE                  0x00
+#define MB_EX_ILLEGAL_FUNCTION      0x01
+#define MB_EX_ILLEGAL_ADDRESS       0x02
+#define MB_EX_ILLEGAL_VALUE         0x03
+#define MB_EX_DEVICE_FAILURE        0x04
+#define MB_EX_DEVICE_BUSY           0x06
+#define MB_EX_GATEWAY_PATH          0x0A   // Gateway path unavailable
+#define MB_EX_GATEWAY_TARGET        0x0B   // Gateway target device failed to respond
+
+// Largest PDU (function code + data)
+#define MB_MAX_PDU                  253
+
+// Outcome of a master transaction
+enum ModbusResult {
+    MB_RESULT_IDLE,             // Never submitted
+    MB_RESULT_PENDING,          // Queued or waiting for the reply
+    MB_RESULT_SUCCESS,
+    MB_RESULT_EXCEPTION,        // Slave replied with an exception (see exceptionCode)
+    MB_RESULT_TIMEOUT,          // No complete reply within the timeout
+    MB_RESULT_CRC_ERROR,        // Reply received but the CRC did not match
+    MB_RESULT_INVALID_RESPONSE, // Reply from the wrong slave/function or with a bad length
+    MB_RESULT_INVALID_REQUEST,  // Unsupported function, bad count or missing buffer
+    MB_RESULT_QUEUE_FULL,
+    MB_RESULT_NOT_MASTER,       // Port is running as a Modbus server
+    MB_RESULT_SLAVE_OFFLINE     // Slave marked offline, request not sent (see ModbusSlaveHealth)
+};
+
+// Data tables
+enum ModbusRegType {
+    MB_COIL,
+    MB_DISCRETE_INPUT,
+    MB_HOLDING_REG,
+    MB_INPUT_REG
+};
+
+#endif // MODBUS_DEFS_H
\ No newline at end of file
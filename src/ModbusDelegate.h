@@ -0,0 +1,58 @@
+/**
+ * ModbusDelegate.h - Allocation-free callback type for Cortex Link A8R-M ESP32 IoT Smart Home Controller
+ *
+ * A function pointer plus a context pointer, copied by value. Unlike
+ * std::function it never allocates, and a call is one indirect call with
+ * no type-erasure layer in between. Member functions are bound through a
+ * stub generated at compile time:
+ *
+ *   cbModbus cb = cbModbus::bind<RegisterMap, &RegisterMap::handle>(this);
+ *
+ * Free functions take the context as their first argument. The context
+ * must outlive the delegate; handlers are registered once at startup and
+ * their objects are globals, so this holds for every user in the tree.
+ */
+
+#ifndef MODBUS_DELEGATE_H
+#define MODBUS_DELEGATE_H
+
+template <typename R, typename A>
+class ModbusDelegate {
+public:
+    typedef R (*Function)(void* context, A& arg);
+
+    ModbusDelegate() :
+        function(nullptr),
+        context(nullptr)
+    {
+    }
+
+    ModbusDelegate(Function fn, void* ctx) :
+        function(fn),
+        context(ctx)
+    {
+    }
+
+    /**
+     * Delegate calling object->Method(arg)
+     */
+    template <typename T, R (T::*Method)(A&)>
+    static ModbusDelegate bind(T* object) {
+        return ModbusDelegate(&methodStub<T, Method>, object);
+    }
+
+    R operator()(A& arg) const { return function(context, arg); }
+
+    explicit operator bool() const { return function != nullptr; }
+
+private:
+    Function function;
+    void* context;
+
+    template <typename T, R (T::*Method)(A&)>
+    static R methodStub(void* object, A& arg) {
+        return (static_cast<T*>(object)->*Method)(arg);
+    }
+};
+
+#endif // MODBUS_DELEGATE_H
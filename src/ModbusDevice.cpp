@@ -0,0 +1,133 @@
+/**
+ * ModbusDevice.cpp - Implementation of the profile-driven Modbus device
+ */
+
+#include "ModbusDevice.h"
+
+ModbusDevice::ModbusDevice() :
+    poller(nullptr),
+    profile(nullptr),
+    slaveId(0),
+    readCount(0)
+{
+}
+
+bool ModbusDevice::gapBetween(const DeviceProfile& profile, uint8_t function, uint32_t from, uint32_t to) {
+    for (uint8_t i = 0; i < profile.gapCount; i++) {
+        const ProfileGap& gap = profile.gaps[i];
+        if (gap.function == function && gap.start < to && from < (uint32_t)gap.start + gap.count) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ModbusDevice::begin(ModbusPoller& modbusPoller, uint8_t slave, const DeviceProfile& deviceProfile,
+                         unsigned long periodMs) {
+    if (deviceProfile.pointCount > MB_PROFILE_MAX_POINTS) {
+        return false;
+    }
+
+    poller = &modbusPoller;
+    profile = &deviceProfile;
+    slaveId = slave;
+    readCount = 0;
+
+    const ProfilePoint* points = profile->points;
+    uint8_t first = 0;
+    while (first < profile->pointCount) {
+        const ProfilePoint& head = points[first];
+        uint32_t start = head.address;
+        uint32_t end = start + ProfileCheck::width(head);
+
+        // Greedy from the lowest address gives the fewest reads: take the
+        // next point while the block stays within the limit and gap-free
+        uint8_t last = first + 1;
+        while (last < profile->pointCount) {
+            const ProfilePoint& p = points[last];
+            uint32_t pointEnd = (uint32_t)p.address + ProfileCheck::width(p);
+            if (p.function != head.function || pointEnd - start > profile->maxPerRead ||
+                gapBetween(*profile, head.function, end, p.address)) {
+                break;
+            }
+            end = pointEnd;
+            last++;
+        }
+
+        int8_t item = poller->addItem(slaveId, head.function, start, end - start, periodMs, profile->maxPerRead);
+        if (item < 0) {
+            return false;
+        }
+        for (uint8_t i = first; i < last; i++) {
+            pointItem[i] = item;
+            pointOffset[i] = points[i].address - start;
+        }
+
+        readCount++;
+        first = last;
+    }
+
+    return true;
+}
+
+bool ModbusDevice::read(uint8_t point, float& value) const {
+    if (profile == nullptr || point >= profile->pointCount) {
+        return false;
+    }
+
+    const uint16_t* raw = poller->getValues(pointItem[point]);
+    if (raw == nullptr) {
+        return false;
+    }
+    raw += pointOffset[point];
+
+    const ProfilePoint& p = profile->points[point];
+    uint32_t word32 = 0;
+    if (ProfileCheck::width(p) == 2) {
+        word32 = profile->lowWordFirst ? ((uint32_t)raw[1] << 16) | raw[0] : ((uint32_t)raw[0] << 16) | raw[1];
+    }
+
+    switch (p.encoding) {
+        case PE_U16:
+        case PE_BIT:
+            value = raw[0] * p.scale;
+            break;
+        case PE_S16:
+            value = (int16_t)raw[0] * p.scale;
+            break;
+        case PE_U32:
+            value = word32 * p.scale;
+            break;
+        case PE_S32:
+            value = (int32_t)word32 * p.scale;
+            break;
+        case PE_FLOAT32: {
+            float f;
+            memcpy(&f, &word32, sizeof(f));
+            value = f * p.scale;
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool ModbusDevice::isStale(uint8_t point) const {
+    if (profile == nullptr || point >= profile->pointCount) {
+        return true;
+    }
+    return poller->isStale(pointItem[point]);
+}
+
+int8_t ModbusDevice::findPoint(const char* name) const {
+    if (profile == nullptr) {
+        return -1;
+    }
+
+    for (uint8_t i = 0; i < profile->pointCount; i++) {
+        if (strcmp(profile->points[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
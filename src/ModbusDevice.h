@@ -0,0 +1,69 @@
+/**
+ * ModbusDevice.h - Profile-driven downstream Modbus device for Cortex Link A8R-M ESP32 IoT Smart Home Controller
+ *
+ * Binds a DeviceProfile to a slave address. begin() plans the fewest
+ * block reads that cover every point: points of one function are taken
+ * in address order and a block grows until the next point would exceed
+ * the device's read limit or cross one of its gaps. The blocks are polled
+ * by ModbusPoller and points are decoded from its cache on demand.
+ */
+
+#ifndef MODBUS_DEVICE_H
+#define MODBUS_DEVICE_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "DeviceProfiles.h"
+#include "ModbusPoller.h"
+
+class ModbusDevice {
+public:
+    ModbusDevice();
+
+    /**
+     * Plan the block reads and add them to the poller
+     * @param poller Poll table the blocks are added to
+     * @param slaveId Slave address (1-247)
+     * @param profile Device profile
+     * @param periodMs Poll period in ms
+     * @return false if the profile has too many points or the poller is full
+     */
+    bool begin(ModbusPoller& poller, uint8_t slaveId, const DeviceProfile& profile, unsigned long periodMs);
+
+    /**
+     * Decoded value of a point (raw * scale)
+     * @return false if the point is unknown or has not been read yet
+     */
+    bool read(uint8_t point, float& value) const;
+
+    /**
+     * Check if a point's value is out of date (see ModbusPoller::isStale)
+     */
+    bool isStale(uint8_t point) const;
+
+    /**
+     * Index of a point by name
+     * @return -1 if the profile has no such point
+     */
+    int8_t findPoint(const char* name) const;
+
+    /**
+     * Number of block reads the profile was planned into
+     */
+    uint8_t getReadCount() const { return readCount; }
+
+    const DeviceProfile* getProfile() const { return profile; }
+    uint8_t getSlaveId() const { return slaveId; }
+
+private:
+    ModbusPoller* poller;
+    const DeviceProfile* profile;
+    uint8_t slaveId;
+    uint8_t readCount;
+    int8_t pointItem[MB_PROFILE_MAX_POINTS];     // Poller item holding the point
+    uint16_t pointOffset[MB_PROFILE_MAX_POINTS]; // Offset of the point in that item
+
+    static bool gapBetween(const DeviceProfile& profile, uint8_t function, uint32_t from, uint32_t to);
+};
+
+#endif // MODBUS_DEVICE_H
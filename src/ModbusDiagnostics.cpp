@@ -0,0 +1,210 @@
+/**
+ * ModbusDiagnostics.cpp - Implementation of the Modbus RTU diagnostics
+ */
+
+#include "ModbusDiagnostics.h"
+
+#if MB_DIAG_SLAVE_REGS != 8 + MB_DIAG_HISTOGRAM_BUCKETS
+#error "MB_DIAG_SLAVE_REGS must hold 8 counters and the histogram"
+#endif
+
+static_assert(MB_DIAG_SERVER_REGS == MB_DIAG_SERVER_COUNTERS, "One register per FC08 counter");
+
+// FC08 sub-functions
+#define MB_DIAG_SUB_RETURN_QUERY      0x00
+#define MB_DIAG_SUB_RESTART           0x01
+#define MB_DIAG_SUB_DIAG_REGISTER     0x02
+#define MB_DIAG_SUB_CLEAR_COUNTERS    0x0A
+#define MB_DIAG_SUB_FIRST_COUNTER     0x0B
+
+static const uint16_t bucketLimits[MB_DIAG_HISTOGRAM_BUCKETS - 1] = {
+    5, 10, 20, 50, 100, 200, 500
+};
+
+ModbusDiagnostics::ModbusDiagnostics() {
+    clearServer();
+    clearMaster();
+}
+
+void ModbusDiagnostics::clearServer() {
+    memset(serverCounters, 0, sizeof(serverCounters));
+}
+
+void ModbusDiagnostics::clearMaster() {
+    memset(slaves, 0, sizeof(slaves));
+}
+
+uint16_t ModbusDiagnostics::getBucketLimit(uint8_t bucket) {
+    return (bucket < MB_DIAG_HISTOGRAM_BUCKETS - 1) ? bucketLimits[bucket] : 0;
+}
+
+ModbusSlaveStats* ModbusDiagnostics::findSlave(uint8_t slaveId, bool create) {
+    for (uint8_t i = 0; i < MB_DIAG_MAX_SLAVES; i++) {
+        if (slaves[i].slaveId == slaveId) {
+            return &slaves[i];
+        }
+    }
+
+    if (!create) {
+        return nullptr;
+    }
+
+    for (uint8_t i = 0; i < MB_DIAG_MAX_SLAVES; i++) {
+        if (slaves[i].slaveId == 0) {
+            slaves[i].slaveId = slaveId;
+            return &slaves[i];
+        }
+    }
+
+    return nullptr;  // Table full, the slave is not tracked
+}
+
+const ModbusSlaveStats* ModbusDiagnostics::getSlaveStats(uint8_t slaveId) const {
+    if (slaveId == 0) {
+        return nullptr;
+    }
+    return const_cast<ModbusDiagnostics*>(this)->findSlave(slaveId, false);
+}
+
+void ModbusDiagnostics::recordMaster(uint8_t slaveId, ModbusResult result, uint32_t roundTripMicros) {
+    ModbusSlaveStats* stats = (slaveId != 0) ? findSlave(slaveId, true) : nullptr;
+    if (stats == nullptr) {
+        return;
+    }
+
+    stats->requests++;
+
+    switch (result) {
+        case MB_RESULT_SUCCESS:
+            stats->successes++;
+            break;
+        case MB_RESULT_EXCEPTION:
+            stats->exceptions++;
+            break;
+        case MB_RESULT_TIMEOUT:
+            stats->timeouts++;
+            return;
+        case MB_RESULT_CRC_ERROR:
+            stats->crcErrors++;
+            return;
+        default:
+            stats->invalidResponses++;
+            return;
+    }
+
+    // Only requests the slave answered tell us about its latency
+    uint32_t ms = roundTripMicros / 1000;
+    uint16_t roundTrip = (ms > 0xFFFF) ? 0xFFFF : ms;
+    if (roundTrip > stats->maxRoundTrip) {
+        stats->maxRoundTrip = roundTrip;
+    }
+
+    uint8_t bucket = 0;
+    while (bucket < MB_DIAG_HISTOGRAM_BUCKETS - 1 && roundTrip >= bucketLimits[bucket]) {
+        bucket++;
+    }
+    stats->histogram[bucket]++;
+}
+
+uint16_t ModbusDiagnostics::processRequest(const uint8_t* request, uint16_t length, uint8_t* response) {
+    if (length < 5) {
+        response[0] = MB_FC_DIAGNOSTICS | 0x80;
+        response[1] = MB_EX_ILLEGAL_VALUE;
+        return 2;
+    }
+
+    uint16_t subFunction = (request[1] << 8) | request[2];
+    uint16_t data = (request[3] << 8) | request[4];
+    uint8_t ex = MB_EX_NONE;
+
+    memcpy(response, request, 5);
+
+    switch (subFunction) {
+        case MB_DIAG_SUB_RETURN_QUERY:
+            // Echo the whole query
+            memcpy(response, request, length);
+            return length;
+
+        case MB_DIAG_SUB_RESTART:
+            if (length != 5 || (data != 0x0000 && data != 0xFF00)) {
+                ex = MB_EX_ILLEGAL_VALUE;
+            }
+            else {
+                clearServer();
+            }
+            break;
+
+        case MB_DIAG_SUB_DIAG_REGISTER:
+            if (length != 5 || data != 0) {
+                ex = MB_EX_ILLEGAL_VALUE;
+            }
+            else {
+                response[3] = 0;
+                response[4] = 0;
+            }
+            break;
+
+        case MB_DIAG_SUB_CLEAR_COUNTERS:
+            if (length != 5 || data != 0) {
+                ex = MB_EX_ILLEGAL_VALUE;
+            }
+            else {
+                clearServer();
+            }
+            break;
+
+        default:
+            if (subFunction < MB_DIAG_SUB_FIRST_COUNTER ||
+                subFunction >= MB_DIAG_SUB_FIRST_COUNTER + MB_DIAG_SERVER_COUNTERS) {
+                ex = MB_EX_ILLEGAL_FUNCTION;
+            }
+            else if (length != 5 || data != 0) {
+                ex = MB_EX_ILLEGAL_VALUE;
+            }
+            else {
+                uint16_t value = serverCounters[subFunction - MB_DIAG_SUB_FIRST_COUNTER];
+                response[3] = value >> 8;
+                response[4] = value & 0xFF;
+            }
+            break;
+    }
+
+    if (ex != MB_EX_NONE) {
+        response[0] = MB_FC_DIAGNOSTICS | 0x80;
+        response[1] = ex;
+        return 2;
+    }
+
+    return 5;
+}
+
+uint16_t ModbusDiagnostics::slaveRegister(const ModbusSlaveStats& stats, uint8_t field) {
+    switch (field) {
+        case 0: return stats.slaveId;
+        case 1: return stats.requests;
+        case 2: return stats.successes;
+        case 3: return stats.exceptions;
+        case 4: return stats.timeouts;
+        case 5: return stats.crcErrors;
+        case 6: return stats.invalidResponses;
+        case 7: return stats.maxRoundTrip;
+        default: return stats.histogram[field - 8];
+    }
+}
+
+void ModbusDiagnostics::readRegisters(uint16_t offset, uint16_t count, uint16_t* values) const {
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t index = offset + i;
+
+        if (index < MB_DIAG_SERVER_REGS) {
+            values[i] = serverCounters[index];
+        }
+        else if (index < MB_DIAG_WINDOW_SIZE) {
+            index -= MB_DIAG_SERVER_REGS;
+            values[i] = slaveRegister(slaves[index / MB_DIAG_SLAVE_REGS], index % MB_DIAG_SLAVE_REGS);
+        }
+        else {
+            values[i] = 0;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+/**
+ * ModbusDiagnostics.h - Modbus RTU diagnostics for Cortex Link A8R-M ESP32 IoT Smart Home Controller
+ *
+ * Server side: the serial line counters of function code 08, answered
+ * from here for FC08 requests and readable as registers. Master side:
+ * per-slave request outcomes and a round-trip time histogram, so slow
+ * scans can be traced to CRC errors, timeouts or slow slaves. Counters
+ * are 16 bit and wrap, as in FC08.
+ */
+
+#ifndef MODBUS_DIAGNOSTICS_H
+#define MODBUS_DIAGNOSTICS_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "ModbusDefs.h"
+
+// FC08 counters, in sub-function order 0x0B..0x12
+enum ModbusServerCounter {
+    MB_DIAG_BUS_MESSAGES,        // Frames seen on the bus
+    MB_DIAG_BUS_COMM_ERRORS,     // CRC errors and runt frames
+    MB_DIAG_BUS_EXCEPTIONS,      // Exception responses sent
+    MB_DIAG_SERVER_MESSAGES,     // Frames addressed to this board (incl. broadcasts)
+    MB_DIAG_SERVER_NO_RESPONSE,  // Requests processed without a reply (broadcasts)
+    MB_DIAG_SERVER_NAK,          // Never used, kept for FC08 numbering
+    MB_DIAG_SERVER_BUSY,         // Never used, kept for FC08 numbering
+    MB_DIAG_CHAR_OVERRUNS,       // UART FIFO/buffer overruns and oversized frames
+    MB_DIAG_SERVER_COUNTERS
+};
+
+// Master statistics for one RS485 slave
+struct ModbusSlaveStats {
+    uint8_t slaveId;             // 0 = slot unused
+    uint16_t requests;
+    uint16_t successes;
+    uint16_t exceptions;
+    uint16_t timeouts;
+    uint16_t crcErrors;
+    uint16_t invalidResponses;
+    uint16_t maxRoundTrip;       // ms, answered requests only
+    uint16_t histogram[MB_DIAG_HISTOGRAM_BUCKETS];
+};
+
+class ModbusDiagnostics {
+public:
+    ModbusDiagnostics();
+
+    /**
+     * Add to a server counter
+     */
+    void countServer(ModbusServerCounter counter, uint16_t n = 1) { serverCounters[counter] += n; }
+
+    /**
+     * Current value of a server counter
+     */
+    uint16_t getServerCounter(ModbusServerCounter counter) const { return serverCounters[counter]; }
+
+    /**
+     * Record the outcome of a master transaction
+     * @param slaveId RS485 slave address (not 0)
+     * @param result Outcome of the transaction
+     * @param roundTripMicros End of request to end of reply
+     */
+    void recordMaster(uint8_t slaveId, ModbusResult result, uint32_t roundTripMicros);
+
+    /**
+     * Statistics of one slave
+     * @return nullptr if the slave has not been addressed (or no slot was free)
+     */
+    const ModbusSlaveStats* getSlaveStats(uint8_t slaveId) const;
+
+    /**
+     * Upper limit of a histogram bucket in ms (0 for the last, open bucket)
+     */
+    static uint16_t getBucketLimit(uint8_t bucket);
+
+    void clearServer();
+    void clearMaster();
+
+    /**
+     * Answer an FC08 request
+     * @param request Request PDU (function code first)
+     * @param length Request PDU length
+     * @param response Buffer for the response PDU
+     * @return Response PDU length
+     */
+    uint16_t processRequest(const uint8_t* request, uint16_t length, uint8_t* response);
+
+    /**
+     * Copy part of the diagnostics window (layout in Config.h)
+     * @param offset First register relative to MB_REG_DIAG_START
+     */
+    void readRegisters(uint16_t offset, uint16_t count, uint16_t* values) const;
+
+private:
+    uint16_t serverCounters[MB_DIAG_SERVER_COUNTERS];
+    ModbusSlaveStats slaves[MB_DIAG_MAX_SLAVES];
+
+    ModbusSlaveStats* findSlave(uint8_t slaveId, bool create);
+    static uint16_t slaveRegister(const ModbusSlaveStats& stats, uint8_t field);
+};
+
+#endif // MODBUS_DIAGNOSTICS_H
\ No newline at end of file
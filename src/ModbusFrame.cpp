@@ -0,0 +1,179 @@
+/**
+ * ModbusFrame.cpp - Implementation of the Modbus RTU frame codec
+ */
+
+#include "ModbusFrame.h"
+
+// CRC16 of every byte value, polynomial 0xA001 (0x8005 reflected)
+static const uint16_t crcTable0[256] = {
+    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040,
+};
+
+// Slicing-by-4 tables, derived from crcTable0 on first use
+static uint16_t crcSlices[3][256];
+static bool crcSlicesReady = false;
+
+static void buildSlices() {
+    for (uint16_t i = 0; i < 256; i++) {
+        uint16_t crc = crcTable0[i];
+        for (uint8_t k = 0; k < 3; k++) {
+            crc = (crc >> 8) ^ crcTable0[crc & 0xFF];
+            crcSlices[k][i] = crc;
+        }
+    }
+    crcSlicesReady = true;
+}
+
+uint16_t ModbusFrame::crc16(const uint8_t* data, uint16_t length) {
+    return crc16(MB_CRC_METHOD, data, length);
+}
+
+uint16_t ModbusFrame::crc16(ModbusCrcMethod method, const uint8_t* data, uint16_t length) {
+    switch (method) {
+        case MB_CRC_BITWISE:
+            return crcBitwise(data, length);
+        case MB_CRC_SLICING4:
+            return crcSlicing4(data, length);
+        default:
+            return crcTable(data, length);
+    }
+}
+
+uint16_t ModbusFrame::crcBitwise(const uint8_t* data, uint16_t length) {
+    uint16_t crc = 0xFFFF;
+    for (uint16_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x0001) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+uint16_t ModbusFrame::crcTable(const uint8_t* data, uint16_t length) {
+    uint16_t crc = 0xFFFF;
+    for (uint16_t i = 0; i < length; i++) {
+        crc = (crc >> 8) ^ crcTable0[(crc ^ data[i]) & 0xFF];
+    }
+    return crc;
+}
+
+uint16_t ModbusFrame::crcSlicing4(const uint8_t* data, uint16_t length) {
+    if (!crcSlicesReady) {
+        buildSlices();
+    }
+
+    uint16_t crc = 0xFFFF;
+
+    // Four bytes per step, each table advances its byte by the bytes after it
+    while (length >= 4) {
+        uint32_t x = crc ^ (data[0] | (data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24));
+        crc = crcSlices[2][x & 0xFF] ^
+              crcSlices[1][(x >> 8) & 0xFF] ^
+              crcSlices[0][(x >> 16) & 0xFF] ^
+              crcTable0[x >> 24];
+        data += 4;
+        length -= 4;
+    }
+
+    while (length--) {
+        crc = (crc >> 8) ^ crcTable0[(crc ^ *data++) & 0xFF];
+    }
+
+    return crc;
+}
+
+uint16_t ModbusFrame::seal(uint8_t* frame, uint16_t length) {
+    uint16_t crc = crc16(frame, length);
+    frame[length++] = crc & 0xFF;
+    frame[length++] = crc >> 8;
+    return length;
+}
+
+uint16_t ModbusFrame::encode(uint8_t* frame, uint8_t unitId, const uint8_t* pdu, uint16_t pduLength) {
+    if (pdu != frame + 1) {
+        memmove(frame + 1, pdu, pduLength);
+    }
+    frame[0] = unitId;
+    return seal(frame, pduLength + 1);
+}
+
+bool ModbusFrame::check(const uint8_t* frame, uint16_t length) {
+    // The CRC over a frame including its own CRC is zero
+    return length >= 4 && crc16(frame, length) == 0;
+}
+
+#ifdef MODBUS_BENCHMARK
+void ModbusFrame::benchmark(Print& out, uint16_t frameLength, uint16_t iterations) {
+    static const char* names[] = { "bitwise", "table", "slicing-by-4" };
+    uint8_t frame[MB_RTU_MAX_FRAME];
+
+    if (frameLength > MB_RTU_MAX_FRAME) {
+        frameLength = MB_RTU_MAX_FRAME;
+    }
+    for (uint16_t i = 0; i < frameLength; i++) {
+        frame[i] = i * 31 + 7;
+    }
+
+    // Every method against the bitwise reference, for each length up to
+    // frameLength, and the read request 01 03 00 00 00 0A (CRC C5 CD)
+    static const uint8_t request[] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0A };
+    bool agree = crc16(MB_CRC_BITWISE, request, sizeof(request)) == 0xCDC5;
+    for (uint8_t method = MB_CRC_TABLE; method <= MB_CRC_SLICING4; method++) {
+        agree = agree && crc16((ModbusCrcMethod)method, request, sizeof(request)) == 0xCDC5;
+        for (uint16_t length = 0; agree && length <= frameLength; length++) {
+            agree = crc16((ModbusCrcMethod)method, frame, length) == crc16(MB_CRC_BITWISE, frame, length);
+        }
+    }
+
+    out.printf("Modbus CRC16, %u byte frames, %u runs, methods %s:\n", frameLength, iterations,
+               agree ? "agree" : "DISAGREE");
+    for (uint8_t method = MB_CRC_BITWISE; method <= MB_CRC_SLICING4; method++) {
+        volatile uint16_t sink = 0;
+
+        // First call outside the timing, slicing-by-4 builds its tables there
+        sink ^= crc16((ModbusCrcMethod)method, frame, frameLength);
+
+        unsigned long start = micros();
+        for (uint16_t n = 0; n < iterations; n++) {
+            sink ^= crc16((ModbusCrcMethod)method, frame, frameLength);
+        }
+        unsigned long elapsed = micros() - start;
+
+        double bytesPerSecond = (double)frameLength * iterations * 1000000.0 / (elapsed ? elapsed : 1);
+        out.printf("  %-13s %.0f bytes/s, %.2f us/frame%s\n", names[method], bytesPerSecond,
+                   (double)elapsed / iterations, (method == MB_CRC_METHOD) ? " (selected)" : "");
+    }
+}
+#endif
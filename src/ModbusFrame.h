@@ -0,0 +1,77 @@
+/**
+ * ModbusFrame.h - Modbus RTU frame codec for Cortex Link A8R-M ESP32 IoT Smart Home Controller
+ *
+ * Wraps a PDU into an RTU frame (unit ID + PDU + CRC16) and checks
+ * received frames. The CRC runs once per frame in each direction, so in
+ * gateway mode every forwarded request costs two passes; the method is
+ * selectable with MB_CRC_METHOD:
+ *   MB_CRC_BITWISE  - no table, 8 shift/xor steps per byte
+ *   MB_CRC_TABLE    - one 512 byte table lookup per byte
+ *   MB_CRC_SLICING4 - four bytes per step with four tables (2 KB RAM)
+ * The ESP32 ROM only has CRC-16/CCITT (polynomial 0x1021), which is not
+ * the Modbus CRC (0xA001 reflected), so it is not offered here.
+ */
+
+#ifndef MODBUS_FRAME_H
+#define MODBUS_FRAME_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+enum ModbusCrcMethod {
+    MB_CRC_BITWISE,
+    MB_CRC_TABLE,
+    MB_CRC_SLICING4
+};
+
+class ModbusFrame {
+public:
+    /**
+     * Modbus CRC16 with the configured method (MB_CRC_METHOD)
+     */
+    static uint16_t crc16(const uint8_t* data, uint16_t length);
+
+    /**
+     * Modbus CRC16 with an explicit method
+     */
+    static uint16_t crc16(ModbusCrcMethod method, const uint8_t* data, uint16_t length);
+
+    /**
+     * Append the CRC to a frame that holds unit ID and PDU
+     * @param frame Frame buffer with room for two more bytes
+     * @param length Unit ID + PDU length
+     * @return Frame length including the CRC
+     */
+    static uint16_t seal(uint8_t* frame, uint16_t length);
+
+    /**
+     * Build a complete frame
+     * @param frame Destination, at least pduLength + 3 bytes
+     * @param unitId Slave address
+     * @param pdu Request or response PDU (may already sit at frame + 1)
+     * @param pduLength PDU length
+     * @return Frame length
+     */
+    static uint16_t encode(uint8_t* frame, uint8_t unitId, const uint8_t* pdu, uint16_t pduLength);
+
+    /**
+     * Check the CRC of a received frame
+     * @return true if the frame is at least 4 bytes long and its CRC matches
+     */
+    static bool check(const uint8_t* frame, uint16_t length);
+
+#ifdef MODBUS_BENCHMARK
+    /**
+     * Check that every CRC method matches the bitwise one, then print
+     * each method's throughput in bytes per second and time per frame
+     */
+    static void benchmark(Print& out, uint16_t frameLength = MB_RTU_MAX_FRAME, uint16_t iterations = 1000);
+#endif
+
+private:
+    static uint16_t crcBitwise(const uint8_t* data, uint16_t length);
+    static uint16_t crcTable(const uint8_t* data, uint16_t length);
+    static uint16_t crcSlicing4(const uint8_t* data, uint16_t length);
+};
+
+#endif // MODBUS_FRAME_H
\ No newline at end of file
@@ -0,0 +1,340 @@
+/**
+ * ModbusGateway.cpp - Implementation of the Modbus TCP-to-RTU gateway
+ */
+
+#include "ModbusGateway.h"
+
+#define GW_MAX_ENTRIES (MB_TCP_MAX_CLIENTS * MB_GW_QUEUE_DEPTH)
+
+ModbusGateway::ModbusGateway() :
+    comm(nullptr),
+    responseTimeout(MB_GW_RESPONSE_TIMEOUT),
+    queueTimeout(MB_GW_QUEUE_TIMEOUT),
+    nextConnection(0),
+    activeEntry(-1),
+    coalescedCount(0)
+{
+    for (uint8_t i = 0; i < GW_MAX_ENTRIES; i++) {
+        entries[i].state = ENTRY_FREE;
+    }
+}
+
+void ModbusGateway::begin(ModbusComm& modbus) {
+    comm = &modbus;
+    txn.callback = [this](ModbusTransaction& t) { onComplete(t); };
+}
+
+void ModbusGateway::setTimeouts(uint16_t responseMs, uint16_t queueMs) {
+    responseTimeout = responseMs;
+    queueTimeout = queueMs;
+}
+
+bool ModbusGateway::isRead(uint8_t function) {
+    return function >= MB_FC_READ_COILS && function <= MB_FC_READ_INPUT_REGS;
+}
+
+uint8_t ModbusGateway::validate(const uint8_t* pdu, uint16_t length) {
+    if (length < 5) {
+        return (length >= 1 && pdu[0] > MB_FC_WRITE_MULTIPLE_REGS) ? MB_EX_ILLEGAL_FUNCTION : MB_EX_ILLEGAL_VALUE;
+    }
+
+    uint16_t quantity = (pdu[3] << 8) | pdu[4];
+
+    switch (pdu[0]) {
+        case MB_FC_READ_COILS:
+        case MB_FC_READ_DISCRETE_INPUTS:
+            return (length == 5 && quantity >= 1 && quantity <= 2000) ? MB_EX_NONE : MB_EX_ILLEGAL_VALUE;
+
+        case MB_FC_READ_HOLDING_REGS:
+        case MB_FC_READ_INPUT_REGS:
+            return (length == 5 && quantity >= 1 && quantity <= 125) ? MB_EX_NONE : MB_EX_ILLEGAL_VALUE;
+
+        case MB_FC_WRITE_SINGLE_COIL:
+            return (length == 5 && (quantity == 0xFF00 || quantity == 0x0000)) ? MB_EX_NONE : MB_EX_ILLEGAL_VALUE;
+
+        case MB_FC_WRITE_SINGLE_REG:
+            return (length == 5) ? MB_EX_NONE : MB_EX_ILLEGAL_VALUE;
+
+        case MB_FC_WRITE_MULTIPLE_COILS:
+            return (length >= 6 && quantity >= 1 && quantity <= 1968 &&
+                    pdu[5] == (quantity + 7) / 8 && length == 6 + pdu[5]) ? MB_EX_NONE : MB_EX_ILLEGAL_VALUE;
+
+        case MB_FC_WRITE_MULTIPLE_REGS:
+            return (length >= 6 && quantity >= 1 && quantity <= 123 &&
+                    pdu[5] == quantity * 2 && length == 6 + pdu[5]) ? MB_EX_NONE : MB_EX_ILLEGAL_VALUE;
+
+        default:
+            return MB_EX_ILLEGAL_FUNCTION;
+    }
+}
+
+uint8_t ModbusGateway::enqueue(uint8_t connection, uint16_t transactionId, uint8_t unitId,
+                               const uint8_t* pdu, uint16_t length) {
+    uint8_t ex = validate(pdu, length);
+    if (ex != MB_EX_NONE) {
+        return ex;
+    }
+
+    if (comm == nullptr) {
+        return MB_EX_GATEWAY_PATH;
+    }
+
+    // Each connection gets its own share of the queue
+    uint8_t queued = 0;
+    int8_t freeSlot = -1;
+    for (uint8_t i = 0; i < GW_MAX_ENTRIES; i++) {
+        if (entries[i].state == ENTRY_FREE) {
+            if (freeSlot < 0) {
+                freeSlot = i;
+            }
+        }
+        else if (entries[i].connection == connection && !entries[i].orphaned) {
+            queued++;
+        }
+    }
+
+    if (queued >= MB_GW_QUEUE_DEPTH || freeSlot < 0) {
+        return MB_EX_DEVICE_BUSY;
+    }
+
+    Entry& entry = entries[freeSlot];
+    entry.connection = connection;
+    entry.transactionId = transactionId;
+    entry.unitId = unitId;
+    memcpy(entry.pdu, pdu, length);
+    entry.pduLength = length;
+    entry.queuedAt = millis();
+    entry.orphaned = false;
+
+    // Identical reads share one RS485 transaction
+    int8_t leader = isRead(pdu[0]) ? findLeader(unitId, pdu, length) : -1;
+    if (leader >= 0) {
+        entry.state = ENTRY_FOLLOWER;
+        entry.leader = leader;
+        coalescedCount++;
+    }
+    else {
+        entry.state = ENTRY_QUEUED;
+    }
+
+    return MB_EX_NONE;
+}
+
+int8_t ModbusGateway::findLeader(uint8_t unitId, const uint8_t* pdu, uint16_t length) const {
+    for (uint8_t i = 0; i < GW_MAX_ENTRIES; i++) {
+        const Entry& e = entries[i];
+        if ((e.state == ENTRY_QUEUED || e.state == ENTRY_ACTIVE) && e.unitId == unitId &&
+            e.pduLength == length && memcmp(e.pdu, pdu, length) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void ModbusGateway::dropConnection(uint8_t connection) {
+    for (uint8_t i = 0; i < GW_MAX_ENTRIES; i++) {
+        Entry& e = entries[i];
+        if (e.state == ENTRY_FREE || e.connection != connection) {
+            continue;
+        }
+
+        if (e.state == ENTRY_FOLLOWER) {
+            e.state = ENTRY_FREE;
+        }
+        else {
+            // Still needed by followers or already on the bus
+            e.orphaned = true;
+        }
+    }
+}
+
+void ModbusGateway::task() {
+    unsigned long now = millis();
+
+    for (uint8_t i = 0; i < GW_MAX_ENTRIES; i++) {
+        Entry& e = entries[i];
+        if (e.state != ENTRY_QUEUED) {
+            continue;
+        }
+
+        if (now - e.queuedAt > queueTimeout) {
+            answerException(i, e.pdu[0], MB_EX_GATEWAY_TARGET);
+            continue;
+        }
+
+        if (e.orphaned) {
+            bool hasFollowers = false;
+            for (uint8_t j = 0; j < GW_MAX_ENTRIES; j++) {
+                if (entries[j].state == ENTRY_FOLLOWER && entries[j].leader == i) {
+                    hasFollowers = true;
+                    break;
+                }
+            }
+            if (!hasFollowers) {
+                e.state = ENTRY_FREE;
+            }
+        }
+    }
+
+    if (activeEntry < 0) {
+        int8_t next = pickNext();
+        if (next >= 0) {
+            startEntry(next);
+        }
+    }
+}
+
+int8_t ModbusGateway::pickNext() {
+    // Round-robin over connections, oldest request first within one
+    for (uint8_t c = 0; c < MB_TCP_MAX_CLIENTS; c++) {
+        uint8_t connection = (nextConnection + c) % MB_TCP_MAX_CLIENTS;
+        int8_t oldest = -1;
+
+        for (uint8_t i = 0; i < GW_MAX_ENTRIES; i++) {
+            const Entry& e = entries[i];
+            if (e.state == ENTRY_QUEUED && e.connection == connection &&
+                (oldest < 0 || (long)(e.queuedAt - entries[oldest].queuedAt) < 0)) {
+                oldest = i;
+            }
+        }
+
+        if (oldest >= 0) {
+            nextConnection = (connection + 1) % MB_TCP_MAX_CLIENTS;
+            return oldest;
+        }
+    }
+
+    return -1;
+}
+
+void ModbusGateway::startEntry(uint8_t index) {
+    Entry& e = entries[index];
+    const uint8_t* pdu = e.pdu;
+    uint8_t function = pdu[0];
+    uint16_t address = (pdu[1] << 8) | pdu[2];
+    uint16_t quantity = (pdu[3] << 8) | pdu[4];
+
+    switch (function) {
+        case MB_FC_WRITE_SINGLE_COIL:
+            data[0] = (quantity == 0xFF00) ? 1 : 0;
+            quantity = 1;
+            break;
+
+        case MB_FC_WRITE_SINGLE_REG:
+            data[0] = quantity;
+            quantity = 1;
+            break;
+
+        case MB_FC_WRITE_MULTIPLE_COILS:
+            for (uint16_t i = 0; i < quantity; i++) {
+                data[i] = (pdu[6 + i / 8] >> (i % 8)) & 0x01;
+            }
+            break;
+
+        case MB_FC_WRITE_MULTIPLE_REGS:
+            for (uint16_t i = 0; i < quantity; i++) {
+                data[i] = (pdu[6 + i * 2] << 8) | pdu[7 + i * 2];
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    txn.set(e.unitId, function, address, quantity, data, responseTimeout);
+    e.state = ENTRY_ACTIVE;
+    activeEntry = index;
+
+    if (!comm->submit(txn)) {
+        activeEntry = -1;
+        if (txn.result == MB_RESULT_QUEUE_FULL) {
+            e.state = ENTRY_QUEUED;  // Master busy with other users, retry
+        }
+        else {
+            answerException(index, function, MB_EX_GATEWAY_PATH);
+        }
+    }
+}
+
+void ModbusGateway::onComplete(ModbusTransaction& t) {
+    if (activeEntry < 0) {
+        return;
+    }
+
+    uint8_t index = activeEntry;
+    activeEntry = -1;
+    const uint8_t* pdu = entries[index].pdu;
+    uint8_t function = pdu[0];
+
+    if (t.result == MB_RESULT_SUCCESS) {
+        uint16_t length;
+        responsePdu[0] = function;
+
+        switch (function) {
+            case MB_FC_READ_COILS:
+            case MB_FC_READ_DISCRETE_INPUTS: {
+                uint8_t byteCount = (t.count + 7) / 8;
+                responsePdu[1] = byteCount;
+                memset(&responsePdu[2], 0, byteCount);
+                for (uint16_t i = 0; i < t.count; i++) {
+                    if (data[i]) {
+                        responsePdu[2 + i / 8] |= 1 << (i % 8);
+                    }
+                }
+                length = 2 + byteCount;
+                break;
+            }
+
+            case MB_FC_READ_HOLDING_REGS:
+            case MB_FC_READ_INPUT_REGS:
+                responsePdu[1] = t.count * 2;
+                for (uint16_t i = 0; i < t.count; i++) {
+                    responsePdu[2 + i * 2] = data[i] >> 8;
+                    responsePdu[3 + i * 2] = data[i] & 0xFF;
+                }
+                length = 2 + t.count * 2;
+                break;
+
+            default:
+                // Write replies echo address and value/quantity
+                memcpy(responsePdu, pdu, 5);
+                length = 5;
+                break;
+        }
+
+        answer(index, responsePdu, length);
+    }
+    else if (t.result == MB_RESULT_EXCEPTION) {
+        answerException(index, function, t.exceptionCode);
+    }
+    else {
+        answerException(index, function, MB_EX_GATEWAY_TARGET);
+    }
+
+    // Keep the bus busy
+    int8_t next = pickNext();
+    if (next >= 0) {
+        startEntry(next);
+    }
+}
+
+void ModbusGateway::answer(uint8_t index, const uint8_t* pdu, uint16_t length) {
+    for (uint8_t i = 0; i < GW_MAX_ENTRIES; i++) {
+        Entry& e = entries[i];
+        bool isLeader = (i == index);
+        bool isFollower = (e.state == ENTRY_FOLLOWER && e.leader == index);
+        if (!isLeader && !isFollower) {
+            continue;
+        }
+
+        if (!e.orphaned && responseCallback) {
+            responseCallback(e.connection, e.transactionId, e.unitId, pdu, length);
+        }
+        e.state = ENTRY_FREE;
+    }
+}
+
+void ModbusGateway::answerException(uint8_t index, uint8_t function, uint8_t code) {
+    uint8_t pdu[2] = { (uint8_t)(function | 0x80), code };
+    answer(index, pdu, sizeof(pdu));
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+/**
+ * ModbusGateway.h - Modbus TCP-to-RTU gateway for Cortex Link A8R-M ESP32 IoT Smart Home Controller
+ *
+ * Requests that ModbusTCP receives for unit IDs other than the local one
+ * are queued per TCP connection and forwarded to the RS485 slaves through
+ * ModbusComm's master, one at a time. Connections are served round-robin
+ * so one busy HMI cannot starve the others. A read that is identical to
+ * one already queued or on the bus is attached to it and answered from
+ * the same RS485 transaction. Each answer goes back under the transaction
+ * ID of its own request.
+ */
+
+#ifndef MODBUS_GATEWAY_H
+#define MODBUS_GATEWAY_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "ModbusComm.h"
+
+// Delivers a forwarded request's response PDU to the TCP connection
+typedef std::function<void(uint8_t connection, uint16_t transactionId, uint8_t unitId,
+                           const uint8_t* pdu, uint16_t length)> cbGatewayResponse;
+
+class ModbusGateway {
+public:
+    ModbusGateway();
+
+    /**
+     * Attach the gateway to the RS485 master
+     * @param comm ModbusComm instance in master mode
+     */
+    void begin(ModbusComm& comm);
+
+    /**
+     * Set where responses are delivered (done by ModbusTCP::setGateway)
+     */
+    void onResponse(cbGatewayResponse cb) { responseCallback = cb; }
+
+    /**
+     * Set the RTU reply timeout and the longest time a request may wait for the bus
+     */
+    void setTimeouts(uint16_t responseMs, uint16_t queueMs);
+
+    /**
+     * Queue a request PDU for a downstream slave
+     * @param connection TCP connection index
+     * @param transactionId MBAP transaction ID to answer under
+     * @param unitId RS485 slave address
+     * @param pdu Request PDU (function code first)
+     * @param length PDU length
+     * @return MB_EX_NONE if queued (the answer comes through the response
+     *         callback), otherwise the exception code to answer right away
+     */
+    uint8_t enqueue(uint8_t connection, uint16_t transactionId, uint8_t unitId,
+                    const uint8_t* pdu, uint16_t length);
+
+    /**
+     * Forget all requests of a closed connection
+     */
+    void dropConnection(uint8_t connection);
+
+    /**
+     * Expire old requests and start the next one (call this in the loop)
+     */
+    void task();
+
+    /**
+     * Number of RS485 transactions saved by answering identical reads together
+     */
+    uint32_t getCoalescedCount() const { return coalescedCount; }
+
+private:
+    enum EntryState {
+        ENTRY_FREE,
+        ENTRY_QUEUED,
+        ENTRY_ACTIVE,
+        ENTRY_FOLLOWER       // Waits for the answer of an identical read
+    };
+
+    struct Entry {
+        EntryState state;
+        uint8_t connection;
+        uint16_t transactionId;
+        uint8_t unitId;
+        uint8_t pdu[MB_MAX_PDU];
+        uint16_t pduLength;
+        unsigned long queuedAt;
+        uint8_t leader;
+        bool orphaned;       // Connection closed while on the bus
+    };
+
+    ModbusComm* comm;
+    cbGatewayResponse responseCallback;
+    Entry entries[MB_TCP_MAX_CLIENTS * MB_GW_QUEUE_DEPTH];
+    uint16_t responseTimeout;
+    uint16_t queueTimeout;
+    uint8_t nextConnection;          // Round-robin position
+    int8_t activeEntry;
+    uint32_t coalescedCount;
+
+    ModbusTransaction txn;
+    uint16_t data[2000];             // Largest coil/input read
+    uint8_t responsePdu[MB_MAX_PDU];
+
+    int8_t findLeader(uint8_t unitId, const uint8_t* pdu, uint16_t length) const;
+    int8_t pickNext();
+    void startEntry(uint8_t index);
+    void onComplete(ModbusTransaction& t);
+    void answer(uint8_t index, const uint8_t* pdu, uint16_t length);
+    void answerException(uint8_t index, uint8_t function, uint8_t code);
+    static uint8_t validate(const uint8_t* pdu, uint16_t length);
+    static bool isRead(uint8_t function);
+};
+
+#endif // MODBUS_GATEWAY_H
\ No newline at end of file
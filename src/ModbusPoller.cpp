@@ -0,0 +1,258 @@
+/**
+ * ModbusPoller.cpp - Implementation of the Modbus master poll table
+ */
+
+#include "ModbusPoller.h"
+
+ModbusPoller::ModbusPoller() :
+    comm(nullptr),
+    itemCount(0),
+    blockCount(0),
+    activeBlock(-1),
+    busy(false)
+{
+    memset(cache, 0, sizeof(cache));
+}
+
+void ModbusPoller::begin(ModbusComm& modbus) {
+    comm = &modbus;
+    txn.callback = [this](ModbusTransaction& t) { onComplete(t); };
+}
+
+uint16_t ModbusPoller::maxBlockSize(uint8_t function) {
+    switch (function) {
+        case MB_FC_READ_COILS:
+        case MB_FC_READ_DISCRETE_INPUTS:
+            return 2000;
+        case MB_FC_READ_HOLDING_REGS:
+        case MB_FC_READ_INPUT_REGS:
+            return 125;
+        default:
+            return 0;
+    }
+}
+
+int8_t ModbusPoller::addItem(uint8_t slaveId, uint8_t function, uint16_t start, uint16_t count, unsigned long periodMs,
+                             uint16_t maxBlock) {
+    uint16_t maxCount = maxBlockSize(function);
+    if (maxBlock > 0 && maxBlock < maxCount) {
+        maxCount = maxBlock;
+    }
+    if (itemCount >= MB_POLL_MAX_ITEMS || slaveId == 0 || slaveId > 247 ||
+        count == 0 || count > maxCount || periodMs == 0) {
+        return -1;
+    }
+
+    PollItem& item = items[itemCount++];
+    item.slaveId = slaveId;
+    item.function = function;
+    item.start = start;
+    item.count = count;
+    item.periodMs = periodMs;
+    item.maxBlock = maxCount;
+
+    // Results of a read still on the bus belong to the old plan
+    activeBlock = -1;
+
+    if (!buildPlan()) {
+        itemCount--;
+        buildPlan();
+        return -1;
+    }
+
+    return itemCount - 1;
+}
+
+bool ModbusPoller::buildPlan() {
+    // Order items by slave, function and start address
+    uint8_t order[MB_POLL_MAX_ITEMS];
+    for (uint8_t i = 0; i < itemCount; i++) {
+        uint8_t j = i;
+        while (j > 0) {
+            const PollItem& a = items[order[j - 1]];
+            const PollItem& b = items[i];
+            bool before = (b.slaveId != a.slaveId) ? b.slaveId < a.slaveId :
+                          (b.function != a.function) ? b.function < a.function :
+                          b.start < a.start;
+            if (!before) break;
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    // Merge adjacent or overlapping ranges into blocks of at most one PDU
+    blockCount = 0;
+    for (uint8_t i = 0; i < itemCount; i++) {
+        PollItem& item = items[order[i]];
+        uint32_t itemEnd = (uint32_t)item.start + item.count;
+
+        if (blockCount > 0) {
+            PollBlock& block = blocks[blockCount - 1];
+            uint32_t blockEnd = (uint32_t)block.start + block.count;
+            uint32_t mergedEnd = (itemEnd > blockEnd) ? itemEnd : blockEnd;
+
+            uint16_t limit = (item.maxBlock < block.maxBlock) ? item.maxBlock : block.maxBlock;
+
+            if (block.slaveId == item.slaveId && block.function == item.function &&
+                item.start <= blockEnd && mergedEnd - block.start <= limit) {
+                block.count = mergedEnd - block.start;
+                block.maxBlock = limit;
+                if (item.periodMs < block.periodMs) {
+                    block.periodMs = item.periodMs;
+                }
+                item.block = blockCount - 1;
+                continue;
+            }
+        }
+
+        PollBlock& block = blocks[blockCount];
+        block.slaveId = item.slaveId;
+        block.function = item.function;
+        block.start = item.start;
+        block.count = item.count;
+        block.periodMs = item.periodMs;
+        block.maxBlock = item.maxBlock;
+        item.block = blockCount++;
+    }
+
+    // Lay the blocks out in the cache
+    uint16_t offset = 0;
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < blockCount; i++) {
+        PollBlock& block = blocks[i];
+        if (offset + block.count > MB_POLL_CACHE_SIZE) {
+            return false;
+        }
+        block.cacheOffset = offset;
+        block.nextDue = now;
+        block.lastUpdate = 0;
+        block.valid = false;
+        block.lastResult = MB_RESULT_IDLE;
+        offset += block.count;
+    }
+
+    return true;
+}
+
+void ModbusPoller::task() {
+    if (!busy) {
+        submitNext();
+    }
+}
+
+void ModbusPoller::submitNext() {
+    if (comm == nullptr) {
+        return;
+    }
+
+    // task() and the completion callback (on the RTU task) may both get
+    // here, only one of them submits
+    portENTER_CRITICAL(&lock);
+    bool claimed = !busy;
+    busy = true;
+    portEXIT_CRITICAL(&lock);
+    if (!claimed) {
+        return;
+    }
+
+    // Pick the most overdue block
+    unsigned long now = millis();
+    int8_t next = -1;
+    long mostOverdue = -1;
+    for (uint8_t i = 0; i < blockCount; i++) {
+        long overdue = (long)(now - blocks[i].nextDue);
+        if (overdue > mostOverdue) {
+            mostOverdue = overdue;
+            next = i;
+        }
+    }
+
+    if (next < 0) {
+        busy = false;
+        return;
+    }
+
+    // Set before submitting: the reply may complete on the RTU task
+    // before submit() returns
+    PollBlock& block = blocks[next];
+    activeBlock = next;
+    txn.set(block.slaveId, block.function, block.start, block.count, &cache[block.cacheOffset]);
+
+    if (!comm->submit(txn)) {
+        activeBlock = -1;
+        if (txn.result != MB_RESULT_QUEUE_FULL) {
+            // Not retryable right now (e.g. port is a server): skip this period
+            block.lastResult = txn.result;
+            block.nextDue = now + block.periodMs;
+        }
+        busy = false;
+    }
+}
+
+void ModbusPoller::onComplete(ModbusTransaction& t) {
+    if (activeBlock >= 0) {
+        PollBlock& block = blocks[activeBlock];
+        unsigned long now = millis();
+
+        block.lastResult = t.result;
+        if (t.result == MB_RESULT_SUCCESS) {
+            block.valid = true;
+            block.lastUpdate = now;
+        }
+
+        // Keep the period, but never build up a backlog of missed polls
+        block.nextDue += block.periodMs;
+        if ((long)(now - block.nextDue) > 0) {
+            block.nextDue = now;
+        }
+
+        activeBlock = -1;
+    }
+
+    // Keep the bus busy with the next due block
+    busy = false;
+    submitNext();
+}
+
+const uint16_t* ModbusPoller::getValues(uint8_t item) const {
+    if (item >= itemCount) {
+        return nullptr;
+    }
+
+    const PollItem& it = items[item];
+    const PollBlock& block = blocks[it.block];
+    if (!block.valid) {
+        return nullptr;
+    }
+
+    return &cache[block.cacheOffset + (it.start - block.start)];
+}
+
+unsigned long ModbusPoller::getTimestamp(uint8_t item) const {
+    if (item >= itemCount) {
+        return 0;
+    }
+    return blocks[items[item].block].lastUpdate;
+}
+
+bool ModbusPoller::isStale(uint8_t item) const {
+    if (item >= itemCount) {
+        return true;
+    }
+
+    const PollItem& it = items[item];
+    const PollBlock& block = blocks[it.block];
+    if (!block.valid || block.lastResult != MB_RESULT_SUCCESS) {
+        return true;
+    }
+
+    return millis() - block.lastUpdate > it.periodMs * MB_POLL_STALE_FACTOR;
+}
+
+ModbusResult ModbusPoller::getLastResult(uint8_t item) const {
+    if (item >= itemCount) {
+        return MB_RESULT_IDLE;
+    }
+    return blocks[items[item].block].lastResult;
+}
\ No newline at end of file
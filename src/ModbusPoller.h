@@ -0,0 +1,118 @@
+/**
+ * ModbusPoller.h - Periodic Modbus master poll table for Cortex Link A8R-M ESP32 IoT Smart Home Controller
+ *
+ * Poll items (slave, function, start, count, period) are merged into the
+ * smallest set of read blocks: adjacent or overlapping ranges of the same
+ * slave and function share one PDU up to the protocol maximum. Blocks are
+ * read through ModbusComm's asynchronous master and the results are cached
+ * with a timestamp and a staleness flag.
+ */
+
+#ifndef MODBUS_POLLER_H
+#define MODBUS_POLLER_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "ModbusComm.h"
+
+class ModbusPoller {
+public:
+    ModbusPoller();
+
+    /**
+     * Attach the poller to the Modbus master
+     * @param comm ModbusComm instance running in master mode
+     */
+    void begin(ModbusComm& comm);
+
+    /**
+     * Declare a poll item. Items should be added before polling starts,
+     * adding one rebuilds the block plan and clears the cache.
+     * @param slaveId Slave address (1-247)
+     * @param function MB_FC_READ_COILS, _DISCRETE_INPUTS, _HOLDING_REGS or _INPUT_REGS
+     * @param start First register/bit
+     * @param count Number of registers/bits
+     * @param periodMs Poll period in ms
+     * @param maxBlock Largest read the slave accepts (0 = protocol maximum);
+     *        blocks holding this item are never merged beyond it
+     * @return Item index, or -1 if the item is invalid or the table is full
+     */
+    int8_t addItem(uint8_t slaveId, uint8_t function, uint16_t start, uint16_t count, unsigned long periodMs,
+                   uint16_t maxBlock = 0);
+
+    /**
+     * Submit due blocks (call this in the loop)
+     */
+    void task();
+
+    /**
+     * Cached values of an item, one entry per register or 0/1 per bit
+     * @return Pointer to the values, or nullptr if the item was never read
+     */
+    const uint16_t* getValues(uint8_t item) const;
+
+    /**
+     * millis() of the last successful read of an item
+     */
+    unsigned long getTimestamp(uint8_t item) const;
+
+    /**
+     * Check if an item's cached values are out of date
+     * @return true if never read, the last read failed, or older than
+     *         MB_POLL_STALE_FACTOR periods
+     */
+    bool isStale(uint8_t item) const;
+
+    /**
+     * Result of the most recent read of an item
+     */
+    ModbusResult getLastResult(uint8_t item) const;
+
+    /**
+     * Number of PDUs needed to read every item once
+     */
+    uint8_t getBlockCount() const { return blockCount; }
+
+private:
+    struct PollItem {
+        uint8_t slaveId;
+        uint8_t function;
+        uint16_t start;
+        uint16_t count;
+        unsigned long periodMs;
+        uint16_t maxBlock;
+        uint8_t block;
+    };
+
+    struct PollBlock {
+        uint8_t slaveId;
+        uint8_t function;
+        uint16_t start;
+        uint16_t count;
+        unsigned long periodMs;      // Shortest period of its items
+        uint16_t maxBlock;           // Smallest read limit of its items
+        unsigned long nextDue;
+        unsigned long lastUpdate;
+        uint16_t cacheOffset;
+        bool valid;                  // Read successfully at least once
+        ModbusResult lastResult;
+    };
+
+    ModbusComm* comm;
+    PollItem items[MB_POLL_MAX_ITEMS];
+    PollBlock blocks[MB_POLL_MAX_ITEMS];
+    uint8_t itemCount;
+    uint8_t blockCount;
+    uint16_t cache[MB_POLL_CACHE_SIZE];
+    ModbusTransaction txn;
+    int8_t activeBlock;
+    bool busy;                       // A block is being submitted or on the bus
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    bool buildPlan();
+    void submitNext();
+    void onComplete(ModbusTransaction& t);
+    static uint16_t maxBlockSize(uint8_t function);
+};
+
+#endif // MODBUS_POLLER_H
\ No newline at end of file
@@ -0,0 +1,325 @@
+/**
+ * ModbusScanner.cpp - Implementation of the RS485 discovery scan
+ */
+
+#include "ModbusScanner.h"
+
+static const unsigned long scanBaudRates[] = MB_SCAN_BAUD_RATES;
+static const int8_t scanBaudCount = sizeof(scanBaudRates) / sizeof(scanBaudRates[0]);
+
+// Slave 0 is broadcast, 248-255 are reserved
+static const uint8_t scanMaxId = 247;
+
+// FC03 reply with one register: id, function, byte count, 2 data bytes, CRC
+static const uint8_t scanReplyLength = 7;
+
+ModbusScanner::ModbusScanner() :
+    comm(nullptr),
+    deviceCount(0),
+    knownCount(0),
+    running(false),
+    fullScan(false),
+    stopRequested(false),
+    originalBaud(0),
+    baudIndex(-1),
+    baudPending(false),
+    phase(SCAN_KNOWN),
+    cursor(0),
+    activity(false),
+    maxLatency(0),
+    probeCount(0),
+    startedAt(0),
+    finishedAt(0),
+    rxValue(0),
+    busy(false)
+{
+    memset(devices, 0, sizeof(devices));
+    memset(known, 0, sizeof(known));
+    memset(probed, 0, sizeof(probed));
+}
+
+bool ModbusScanner::start(ModbusComm& modbus, bool full) {
+    if (running) {
+        return false;
+    }
+
+    comm = &modbus;
+    txn.callback = [this](ModbusTransaction& t) { onComplete(t); };
+
+    // Slaves of the previous scan are probed first at every rate
+    knownCount = 0;
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        uint8_t k = 0;
+        while (k < knownCount && known[k] != devices[i].slaveId) {
+            k++;
+        }
+        if (k == knownCount) {
+            known[knownCount++] = devices[i].slaveId;
+        }
+    }
+    deviceCount = 0;
+
+    fullScan = full;
+    stopRequested = false;
+    originalBaud = modbus.getBaudRate();
+    baudIndex = -1;
+    baudPending = false;
+    phase = SCAN_KNOWN;
+    cursor = 0;
+    memset(probed, 0, sizeof(probed));
+    activity = false;
+    maxLatency = 0;
+    probeCount = 0;
+    startedAt = millis();
+    running = true;
+
+    submitNext();
+    return true;
+}
+
+void ModbusScanner::task() {
+    if (running && !busy) {
+        submitNext();
+    }
+}
+
+void ModbusScanner::stop() {
+    stopRequested = true;
+    task();
+}
+
+void ModbusScanner::submitNext() {
+    if (comm == nullptr) {
+        return;
+    }
+
+    // task() and the completion callback (on the RTU task) may both get
+    // here, only one of them submits
+    portENTER_CRITICAL(&lock);
+    bool claimed = !busy;
+    busy = true;
+    portEXIT_CRITICAL(&lock);
+    if (!claimed) {
+        return;
+    }
+
+    if (!running) {
+        busy = false;
+        return;
+    }
+
+    if (stopRequested) {
+        finish();
+        busy = false;
+        return;
+    }
+
+    uint8_t id;
+    for (;;) {
+        // Other requests on the bus refuse the change, task() tries again
+        if (baudPending) {
+            if (!comm->setBaudRate(baudAt(baudIndex))) {
+                busy = false;
+                return;
+            }
+            baudPending = false;
+        }
+
+        id = nextId();
+        if (id != 0) {
+            break;
+        }
+
+        if (!nextBaud()) {
+            finish();
+            busy = false;
+            return;
+        }
+    }
+
+    txn.set(id, MB_FC_READ_HOLDING_REGS, 0, 1, &rxValue, probeTimeout());
+    txn.probe = true;
+
+    if (!comm->submit(txn)) {
+        if (txn.result == MB_RESULT_QUEUE_FULL) {
+            // Probe this ID again on the next try
+            probed[id / 32] &= ~(1UL << (id % 32));
+            cursor--;
+        } else {
+            // The port is a server, its baud rate was never changed
+            running = false;
+            finishedAt = millis();
+        }
+        busy = false;
+        return;
+    }
+
+    probeCount++;
+}
+
+void ModbusScanner::onComplete(ModbusTransaction& t) {
+    switch (t.result) {
+        case MB_RESULT_SUCCESS:
+        case MB_RESULT_EXCEPTION:
+            // An exception still proves a slave with this ID at this rate
+            activity = true;
+            if (t.latencyMicros > maxLatency) {
+                maxLatency = t.latencyMicros;
+            }
+            if (deviceCount < MB_SCAN_MAX_DEVICES) {
+                ModbusScanDevice& device = devices[deviceCount];
+                device.slaveId = t.slaveId;
+                device.baudRate = comm->getBaudRate();
+                device.latencyMicros = t.latencyMicros;
+                device.exceptionCode = (t.result == MB_RESULT_EXCEPTION) ? t.exceptionCode : 0;
+                deviceCount++;
+            }
+            break;
+
+        case MB_RESULT_CRC_ERROR:
+        case MB_RESULT_INVALID_RESPONSE:
+            // Someone is talking, possibly at another rate or ID
+            activity = true;
+            break;
+
+        default:
+            break;
+    }
+
+    // Keep the bus busy with the next probe
+    busy = false;
+    submitNext();
+}
+
+uint8_t ModbusScanner::nextId() {
+    for (;;) {
+        uint8_t id;
+        if (phase == SCAN_KNOWN) {
+            if (cursor >= knownCount) {
+                phase = SCAN_QUICK;
+                cursor = 1;
+                continue;
+            }
+            id = known[cursor++];
+        }
+        else if (phase == SCAN_QUICK) {
+            if (cursor > MB_SCAN_QUICK_IDS || cursor > scanMaxId) {
+                // A silent rate is not worth the other 200+ IDs
+                if (!fullScan && !activity) {
+                    return 0;
+                }
+                phase = SCAN_REST;
+                continue;
+            }
+            id = cursor++;
+        }
+        else {
+            if (cursor > scanMaxId) {
+                return 0;
+            }
+            id = cursor++;
+        }
+
+        if (!(probed[id / 32] & (1UL << (id % 32)))) {
+            probed[id / 32] |= 1UL << (id % 32);
+            return id;
+        }
+    }
+}
+
+bool ModbusScanner::nextBaud() {
+    do {
+        baudIndex++;
+    } while (baudIndex < scanBaudCount && scanBaudRates[baudIndex] == originalBaud);
+
+    if (baudIndex >= scanBaudCount) {
+        return false;
+    }
+
+    baudPending = true;
+    phase = SCAN_KNOWN;
+    cursor = 0;
+    memset(probed, 0, sizeof(probed));
+    activity = false;
+    return true;
+}
+
+unsigned long ModbusScanner::baudAt(int8_t index) const {
+    return (index < 0) ? originalBaud : scanBaudRates[index];
+}
+
+uint16_t ModbusScanner::probeTimeout() const {
+    // Latency budget: the worst case until a slave has shown its speed
+    uint32_t budget = MB_SCAN_TIMEOUT;
+    if (maxLatency > 0) {
+        budget = (maxLatency * MB_SCAN_LATENCY_FACTOR + 999) / 1000;
+        if (budget < MB_SCAN_MIN_TIMEOUT) {
+            budget = MB_SCAN_MIN_TIMEOUT;
+        }
+        if (budget > MB_SCAN_TIMEOUT) {
+            budget = MB_SCAN_TIMEOUT;
+        }
+    }
+
+    // Plus the reply's transmission time and 1 ms for the millis() tick
+    uint32_t replyMs = (scanReplyLength * comm->getCharMicros() + 999) / 1000;
+    return budget + replyMs + 1;
+}
+
+void ModbusScanner::finish() {
+    // Stay at the rate most slaves answered at
+    unsigned long bestBaud = originalBaud;
+    uint8_t bestCount = 0;
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        uint8_t count = 0;
+        for (uint8_t k = 0; k < deviceCount; k++) {
+            if (devices[k].baudRate == devices[i].baudRate) {
+                count++;
+            }
+        }
+        if (count > bestCount) {
+            bestCount = count;
+            bestBaud = devices[i].baudRate;
+        }
+    }
+
+    if (comm->getBaudRate() != bestBaud) {
+        // Retried by task() until the bus is free
+        stopRequested = true;
+        if (!comm->setBaudRate(bestBaud)) {
+            return;
+        }
+    }
+
+    running = false;
+    finishedAt = millis();
+}
+
+const ModbusScanDevice* ModbusScanner::getDevice(uint8_t index) const {
+    return (index < deviceCount) ? &devices[index] : nullptr;
+}
+
+const ModbusScanDevice* ModbusScanner::findDevice(uint8_t slaveId) const {
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        if (devices[i].slaveId == slaveId) {
+            return &devices[i];
+        }
+    }
+    return nullptr;
+}
+
+uint8_t ModbusScanner::addToPoller(ModbusPoller& poller, uint8_t function, uint16_t start, uint16_t count,
+                                   unsigned long periodMs) const {
+    if (comm == nullptr) {
+        return 0;
+    }
+
+    uint8_t added = 0;
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        if (devices[i].baudRate == comm->getBaudRate() &&
+            poller.addItem(devices[i].slaveId, function, start, count, periodMs) >= 0) {
+            added++;
+        }
+    }
+    return added;
+}
@@ -0,0 +1,139 @@
+/**
+ * ModbusScanner.h - RS485 slave and baud rate discovery for Cortex Link A8R-M ESP32 IoT Smart Home Controller
+ *
+ * Probes slave IDs 1-247 at the baud rates in MB_SCAN_BAUD_RATES with a
+ * one register FC03 read through ModbusComm's asynchronous master. Any
+ * reply, including an exception, proves a slave; a garbled reply shows
+ * that something is talking at a different rate. Each completed probe
+ * submits the next one, so the bus never waits for loop().
+ *
+ * Probe order: the port's current rate first, and at every rate the IDs
+ * found by the previous scan, then 1..MB_SCAN_QUICK_IDS. The remaining IDs
+ * are only probed at rates where something answered (or on a full scan).
+ * A probe waits for the reply's transmission time plus a latency budget
+ * of MB_SCAN_TIMEOUT ms, which shrinks to MB_SCAN_LATENCY_FACTOR times
+ * the slowest latency seen once slaves have answered. Probes get no
+ * retries and stay out of the diagnostics and the slave health table.
+ *
+ * The scan changes the baud rate, so other master users (poller,
+ * aggregator) should be idle while it runs. At the end the port is left
+ * at the rate where most slaves were found, or back at its original rate.
+ */
+
+#ifndef MODBUS_SCANNER_H
+#define MODBUS_SCANNER_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "ModbusComm.h"
+#include "ModbusPoller.h"
+
+// One slave found by the scan
+struct ModbusScanDevice {
+    uint8_t slaveId;
+    unsigned long baudRate;
+    uint32_t latencyMicros;  // Reply latency of the probe
+    uint8_t exceptionCode;   // 0 if register 0 could be read
+};
+
+class ModbusScanner {
+public:
+    ModbusScanner();
+
+    /**
+     * Start a scan, the device table is cleared
+     * @param comm ModbusComm instance running in master mode
+     * @param fullScan Probe every ID at every rate, not only where something answered
+     * @return false if a scan is already running
+     */
+    bool start(ModbusComm& comm, bool fullScan = false);
+
+    /**
+     * Keep the scan going (call this in the loop). Completed probes chain
+     * the next one, this only restarts the scan after a refused submit or
+     * baud rate change.
+     */
+    void task();
+
+    /**
+     * Abort the scan after the probe on the bus. The baud rate is set as
+     * at the end of a scan.
+     */
+    void stop();
+
+    bool isRunning() const { return running; }
+
+    uint8_t getDeviceCount() const { return deviceCount; }
+
+    /**
+     * Entry of the device table
+     * @return nullptr if index is out of range
+     */
+    const ModbusScanDevice* getDevice(uint8_t index) const;
+
+    /**
+     * Entry of the device table by slave address
+     * @return nullptr if the slave was not found
+     */
+    const ModbusScanDevice* findDevice(uint8_t slaveId) const;
+
+    /**
+     * Add one poll item per found slave at the port's current baud rate
+     * @return Number of items added
+     */
+    uint8_t addToPoller(ModbusPoller& poller, uint8_t function, uint16_t start, uint16_t count,
+                        unsigned long periodMs) const;
+
+    /**
+     * Probes sent by the last scan
+     */
+    uint16_t getProbeCount() const { return probeCount; }
+
+    /**
+     * Duration of the last scan (or of the running one so far) in ms
+     */
+    unsigned long getDuration() const { return (running ? millis() : finishedAt) - startedAt; }
+
+private:
+    enum ScanPhase {
+        SCAN_KNOWN,                  // IDs found by the previous scan
+        SCAN_QUICK,                  // 1..MB_SCAN_QUICK_IDS
+        SCAN_REST                    // Everything else
+    };
+
+    ModbusComm* comm;
+    ModbusScanDevice devices[MB_SCAN_MAX_DEVICES];
+    uint8_t deviceCount;
+    uint8_t known[MB_SCAN_MAX_DEVICES];
+    uint8_t knownCount;
+
+    bool running;
+    bool fullScan;
+    bool stopRequested;
+    unsigned long originalBaud;
+    int8_t baudIndex;                // -1 = the port's original rate
+    bool baudPending;                // Rate still to be applied to the port
+    ScanPhase phase;
+    uint16_t cursor;
+    uint32_t probed[8];              // IDs probed at the current rate
+    bool activity;                   // Anything answered at the current rate
+    uint32_t maxLatency;             // Slowest reply seen, us
+    uint16_t probeCount;
+    unsigned long startedAt;
+    unsigned long finishedAt;
+
+    ModbusTransaction txn;
+    uint16_t rxValue;
+    bool busy;                       // A probe is being submitted or on the bus
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    void submitNext();
+    void onComplete(ModbusTransaction& t);
+    uint8_t nextId();
+    bool nextBaud();
+    unsigned long baudAt(int8_t index) const;
+    uint16_t probeTimeout() const;
+    void finish();
+};
+
+#endif // MODBUS_SCANNER_H
@@ -0,0 +1,427 @@
+/**
+ * ModbusServer.cpp - Implementation of the Modbus server core
+ */
+
+#include "ModbusServer.h"
+#ifdef MODBUS_BENCHMARK
+#include "Debug.h"
+#endif
+
+#if MB_SERVER_MAX_VALUES < 125 || MB_SERVER_MAX_VALUES < MB_SERVER_BIT_SPACE
+#error "MB_SERVER_MAX_VALUES must hold a full register read and the whole bit space"
+#endif
+
+ModbusServer::ModbusServer() :
+    handlerCount(0),
+    fileCount(0)
+{
+    mutex = xSemaphoreCreateMutex();
+    memset(coilIndex, 0, sizeof(coilIndex));
+    memset(discreteIndex, 0, sizeof(discreteIndex));
+    memset(holdingIndex, 0, sizeof(holdingIndex));
+    memset(inputIndex, 0, sizeof(inputIndex));
+}
+
+uint8_t* ModbusServer::tableIndex(ModbusRegType type, uint16_t& size) {
+    switch (type) {
+        case MB_COIL:
+            size = MB_SERVER_BIT_SPACE;
+            return coilIndex;
+        case MB_DISCRETE_INPUT:
+            size = MB_SERVER_BIT_SPACE;
+            return discreteIndex;
+        case MB_HOLDING_REG:
+            size = MB_SERVER_REG_SPACE;
+            return holdingIndex;
+        default:
+            size = MB_SERVER_REG_SPACE;
+            return inputIndex;
+    }
+}
+
+bool ModbusServer::addHandler(ModbusRegType type, uint16_t address, uint16_t count, cbModbus cb) {
+    uint16_t size;
+    uint8_t* index = tableIndex(type, size);
+
+    if (handlerCount >= MB_SERVER_MAX_HANDLERS || count == 0 || !cb ||
+        (uint32_t)address + count > size) {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        if (index[address + i] != 0) {
+            return false;  // Overlaps an existing handler
+        }
+    }
+
+    HandlerSlot& slot = handlers[handlerCount++];
+    slot.type = type;
+    slot.address = address;
+    slot.count = count;
+    slot.cb = cb;
+
+    memset(&index[address], handlerCount, count);
+
+    return true;
+}
+
+bool ModbusServer::addFileHandler(uint16_t file, cbModbusFile cb) {
+    if (fileCount >= MB_SERVER_MAX_FILES || file == 0 || !cb || findFile(file)) {
+        return false;
+    }
+
+    FileSlot& slot = files[fileCount++];
+    slot.file = file;
+    slot.cb = cb;
+
+    return true;
+}
+
+ModbusServer::FileSlot* ModbusServer::findFile(uint16_t file) {
+    for (uint8_t i = 0; i < fileCount; i++) {
+        if (files[i].file == file) {
+            return &files[i];
+        }
+    }
+    return nullptr;
+}
+
+uint8_t ModbusServer::dispatch(ModbusRegType type, bool write, uint16_t address, uint16_t count) {
+    uint16_t size;
+    const uint8_t* index = tableIndex(type, size);
+
+    if ((uint32_t)address + count > size) {
+        return MB_EX_ILLEGAL_ADDRESS;
+    }
+
+    // The whole range must be mapped before any handler runs, so a write
+    // is never applied partially
+    uint16_t pos = 0;
+    while (pos < count) {
+        uint8_t slot = index[address + pos];
+        if (slot == 0) {
+            return MB_EX_ILLEGAL_ADDRESS;
+        }
+        const HandlerSlot& h = handlers[slot - 1];
+        pos = h.address + h.count - address;
+    }
+
+    // One call per handler covering part of the range
+    pos = 0;
+    while (pos < count) {
+        HandlerSlot& h = handlers[index[address + pos] - 1];
+        uint16_t end = h.address + h.count - address;
+        if (end > count) {
+            end = count;
+        }
+
+        ModbusBlock block;
+        block.type = type;
+        block.write = write;
+        block.address = address + pos;
+        block.offset = block.address - h.address;
+        block.count = end - pos;
+        block.values = &values[pos];
+
+        uint8_t ex = h.cb(block);
+        if (ex != MB_EX_NONE) {
+            return ex;
+        }
+        pos = end;
+    }
+
+    return MB_EX_NONE;
+}
+
+uint16_t ModbusServer::exception(uint8_t function, uint8_t code, uint8_t* response) {
+    response[0] = function | 0x80;
+    response[1] = code;
+    return 2;
+}
+
+uint16_t ModbusServer::processPdu(const uint8_t* request, uint16_t length, uint8_t* response) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    uint16_t responseLength = handlePdu(request, length, response);
+    xSemaphoreGive(mutex);
+
+    return responseLength;
+}
+
+uint16_t ModbusServer::handlePdu(const uint8_t* request, uint16_t length, uint8_t* response) {
+    if (length < 1) {
+        return 0;
+    }
+
+    uint8_t function = request[0];
+    uint16_t address = (length >= 3) ? (request[1] << 8) | request[2] : 0;
+    uint16_t quantity = (length >= 5) ? (request[3] << 8) | request[4] : 0;
+    uint8_t ex;
+
+    switch (function) {
+        case MB_FC_READ_COILS:
+        case MB_FC_READ_DISCRETE_INPUTS: {
+            if (length != 5 || quantity == 0 || quantity > 2000) {
+                return exception(function, MB_EX_ILLEGAL_VALUE, response);
+            }
+
+            ModbusRegType type = (function == MB_FC_READ_COILS) ? MB_COIL : MB_DISCRETE_INPUT;
+            ex = dispatch(type, false, address, quantity);
+            if (ex != MB_EX_NONE) {
+                return exception(function, ex, response);
+            }
+
+            uint8_t byteCount = (quantity + 7) / 8;
+            response[0] = function;
+            response[1] = byteCount;
+            memset(&response[2], 0, byteCount);
+            for (uint16_t i = 0; i < quantity; i++) {
+                if (values[i]) {
+                    response[2 + i / 8] |= 1 << (i % 8);
+                }
+            }
+            return 2 + byteCount;
+        }
+
+        case MB_FC_READ_HOLDING_REGS:
+        case MB_FC_READ_INPUT_REGS: {
+            if (length != 5 || quantity == 0 || quantity > 125) {
+                return exception(function, MB_EX_ILLEGAL_VALUE, response);
+            }
+
+            ModbusRegType type = (function == MB_FC_READ_HOLDING_REGS) ? MB_HOLDING_REG : MB_INPUT_REG;
+            ex = dispatch(type, false, address, quantity);
+            if (ex != MB_EX_NONE) {
+                return exception(function, ex, response);
+            }
+
+            response[0] = function;
+            response[1] = quantity * 2;
+            for (uint16_t i = 0; i < quantity; i++) {
+                response[2 + i * 2] = values[i] >> 8;
+                response[3 + i * 2] = values[i] & 0xFF;
+            }
+            return 2 + quantity * 2;
+        }
+
+        case MB_FC_WRITE_SINGLE_COIL:
+            if (length != 5 || (quantity != 0xFF00 && quantity != 0x0000)) {
+                return exception(function, MB_EX_ILLEGAL_VALUE, response);
+            }
+
+            values[0] = quantity ? 1 : 0;
+            ex = dispatch(MB_COIL, true, address, 1);
+            if (ex != MB_EX_NONE) {
+                return exception(function, ex, response);
+            }
+
+            memcpy(response, request, 5);
+            return 5;
+
+        case MB_FC_WRITE_SINGLE_REG:
+            if (length != 5) {
+                return exception(function, MB_EX_ILLEGAL_VALUE, response);
+            }
+
+            values[0] = quantity;
+            ex = dispatch(MB_HOLDING_REG, true, address, 1);
+            if (ex != MB_EX_NONE) {
+                return exception(function, ex, response);
+            }
+
+            memcpy(response, request, 5);
+            return 5;
+
+        case MB_FC_WRITE_MULTIPLE_COILS: {
+            uint8_t byteCount = (quantity + 7) / 8;
+            if (length < 6 || quantity == 0 || quantity > 1968 ||
+                request[5] != byteCount || length != 6 + byteCount) {
+                return exception(function, MB_EX_ILLEGAL_VALUE, response);
+            }
+            if (quantity > MB_SERVER_MAX_VALUES) {
+                return exception(function, MB_EX_ILLEGAL_ADDRESS, response);
+            }
+
+            for (uint16_t i = 0; i < quantity; i++) {
+                values[i] = (request[6 + i / 8] >> (i % 8)) & 0x01;
+            }
+            ex = dispatch(MB_COIL, true, address, quantity);
+            if (ex != MB_EX_NONE) {
+                return exception(function, ex, response);
+            }
+
+            memcpy(response, request, 5);
+            return 5;
+        }
+
+        case MB_FC_WRITE_MULTIPLE_REGS:
+            if (length < 6 || quantity == 0 || quantity > 123 ||
+                request[5] != quantity * 2 || length != 6 + quantity * 2) {
+                return exception(function, MB_EX_ILLEGAL_VALUE, response);
+            }
+
+            for (uint16_t i = 0; i < quantity; i++) {
+                values[i] = (request[6 + i * 2] << 8) | request[7 + i * 2];
+            }
+            ex = dispatch(MB_HOLDING_REG, true, address, quantity);
+            if (ex != MB_EX_NONE) {
+                return exception(function, ex, response);
+            }
+
+            memcpy(response, request, 5);
+            return 5;
+
+        case MB_FC_READ_FILE_RECORD:
+            return readFileRecords(request, length, response);
+
+        case MB_FC_WRITE_FILE_RECORD:
+            return writeFileRecords(request, length, response);
+
+        default:
+            return exception(function, MB_EX_ILLEGAL_FUNCTION, response);
+    }
+}
+
+// Sub-request: reference type, file number, record number, record length
+uint16_t ModbusServer::readFileRecords(const uint8_t* request, uint16_t length, uint8_t* response) {
+    uint8_t function = request[0];
+    uint8_t byteCount = (length >= 2) ? request[1] : 0;
+    if (byteCount < 7 || byteCount > 0xF5 || byteCount % 7 != 0 || length != 2 + byteCount) {
+        return exception(function, MB_EX_ILLEGAL_VALUE, response);
+    }
+
+    // Check every sub-request and the response size before reading anything
+    uint16_t responseLength = 2;
+    for (uint16_t pos = 2; pos < length; pos += 7) {
+        uint16_t file = (request[pos + 1] << 8) | request[pos + 2];
+        uint16_t record = (request[pos + 3] << 8) | request[pos + 4];
+        uint16_t count = (request[pos + 5] << 8) | request[pos + 6];
+
+        if (request[pos] != MB_FILE_REF_TYPE || record > MB_FILE_MAX_RECORD || !findFile(file)) {
+            return exception(function, MB_EX_ILLEGAL_ADDRESS, response);
+        }
+        // Checked before adding, a huge count would wrap the total
+        if (count == 0 || count > (MB_MAX_PDU - 2) / 2) {
+            return exception(function, MB_EX_ILLEGAL_VALUE, response);
+        }
+        responseLength += 2 + count * 2;
+        if (responseLength > MB_MAX_PDU) {
+            return exception(function, MB_EX_ILLEGAL_VALUE, response);
+        }
+    }
+
+    // The response fits in a PDU, so all values fit in values[]
+    uint16_t out = 2;
+    for (uint16_t pos = 2; pos < length; pos += 7) {
+        ModbusFileBlock block;
+        block.write = false;
+        block.file = (request[pos + 1] << 8) | request[pos + 2];
+        block.record = (request[pos + 3] << 8) | request[pos + 4];
+        block.count = (request[pos + 5] << 8) | request[pos + 6];
+        block.values = values;
+
+        uint8_t ex = findFile(block.file)->cb(block);
+        if (ex != MB_EX_NONE) {
+            return exception(function, ex, response);
+        }
+
+        response[out++] = 1 + block.count * 2;
+        response[out++] = MB_FILE_REF_TYPE;
+        for (uint16_t i = 0; i < block.count; i++) {
+            response[out++] = values[i] >> 8;
+            response[out++] = values[i] & 0xFF;
+        }
+    }
+
+    response[0] = function;
+    response[1] = out - 2;
+    return out;
+}
+
+// Sub-request: reference type, file number, record number, record length, data
+uint16_t ModbusServer::writeFileRecords(const uint8_t* request, uint16_t length, uint8_t* response) {
+    uint8_t function = request[0];
+    uint8_t byteCount = (length >= 2) ? request[1] : 0;
+    if (byteCount < 9 || byteCount > 0xFB || length != 2 + byteCount) {
+        return exception(function, MB_EX_ILLEGAL_VALUE, response);
+    }
+
+    // Walk the sub-requests once to check them, so no file is written
+    // when a later sub-request is malformed
+    for (uint16_t pos = 2; pos < length; ) {
+        if (pos + 7 > length) {
+            return exception(function, MB_EX_ILLEGAL_VALUE, response);
+        }
+        uint16_t file = (request[pos + 1] << 8) | request[pos + 2];
+        uint16_t record = (request[pos + 3] << 8) | request[pos + 4];
+        uint16_t count = (request[pos + 5] << 8) | request[pos + 6];
+
+        if (count == 0 || pos + 7 + count * 2 > length) {
+            return exception(function, MB_EX_ILLEGAL_VALUE, response);
+        }
+        if (request[pos] != MB_FILE_REF_TYPE || record > MB_FILE_MAX_RECORD || !findFile(file)) {
+            return exception(function, MB_EX_ILLEGAL_ADDRESS, response);
+        }
+        pos += 7 + count * 2;
+    }
+
+    for (uint16_t pos = 2; pos < length; ) {
+        ModbusFileBlock block;
+        block.write = true;
+        block.file = (request[pos + 1] << 8) | request[pos + 2];
+        block.record = (request[pos + 3] << 8) | request[pos + 4];
+        block.count = (request[pos + 5] << 8) | request[pos + 6];
+        block.values = values;
+
+        for (uint16_t i = 0; i < block.count; i++) {
+            values[i] = (request[pos + 7 + i * 2] << 8) | request[pos + 8 + i * 2];
+        }
+
+        uint8_t ex = findFile(block.file)->cb(block);
+        if (ex != MB_EX_NONE) {
+            return exception(function, ex, response);
+        }
+        pos += 7 + block.count * 2;
+    }
+
+    // The normal response echoes the request
+    memcpy(response, request, length);
+    return length;
+}
+
+#ifdef MODBUS_BENCHMARK
+void ModbusServer::benchmark(Print& out, uint16_t iterations) {
+    static const uint8_t readFunction[] = {
+        MB_FC_READ_COILS, MB_FC_READ_DISCRETE_INPUTS, MB_FC_READ_HOLDING_REGS, MB_FC_READ_INPUT_REGS
+    };
+    uint8_t request[5];
+    uint8_t response[MB_MAX_PDU];
+
+    // Count this task's allocations, not the RTU task's, while it runs
+    TaskHandle_t counted = Debug::countAllocations(xTaskGetCurrentTaskHandle());
+
+    out.println("Modbus server turnaround:");
+    for (uint8_t i = 0; i < handlerCount; i++) {
+        const HandlerSlot& h = handlers[i];
+        uint16_t count = (h.count > 125) ? 125 : h.count;
+
+        request[0] = readFunction[h.type];
+        request[1] = h.address >> 8;
+        request[2] = h.address & 0xFF;
+        request[3] = count >> 8;
+        request[4] = count & 0xFF;
+
+        uint32_t allocations = Debug::getAllocationCount();
+        unsigned long start = micros();
+        for (uint16_t n = 0; n < iterations; n++) {
+            processPdu(request, sizeof(request), response);
+        }
+        unsigned long elapsed = micros() - start;
+        allocations = Debug::getAllocationCount() - allocations;
+
+        out.printf("  FC%02X %u x%u: %.2f us, %lu allocations\n", request[0], h.address, count,
+                   (double)elapsed / iterations, (unsigned long)allocations);
+    }
+
+    Debug::countAllocations(counted);
+}
+#endif
\ No newline at end of file
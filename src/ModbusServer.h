@@ -0,0 +1,121 @@
+/**
+ * ModbusServer.h - Modbus server core for Cortex Link A8R-M ESP32 IoT Smart Home Controller
+ *
+ * Transport independent: takes a request PDU and builds the response PDU.
+ * Each data table is directly indexed by address, so finding the handler
+ * for a request is one array lookup. A handler is called once for the
+ * part of the request range it owns, with all values in one buffer.
+ * All tables are static, there are no per-register heap objects, and
+ * handlers are plain delegates (ModbusDelegate.h), so serving a request
+ * never touches the heap.
+ * File records (FC20/21) go to a short list of file handlers; every
+ * sub-request of a multi-record request is one handler call.
+ * Requests from different tasks (RTU task, TCP in the loop) are
+ * serialized by a mutex.
+ */
+
+#ifndef MODBUS_SERVER_H
+#define MODBUS_SERVER_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "ModbusDefs.h"
+#include "ModbusDelegate.h"
+
+// Range passed to a server handler
+struct ModbusBlock {
+    ModbusRegType type;
+    bool write;
+    uint16_t address;        // First address of the range
+    uint16_t offset;         // address minus the handler's base address
+    uint16_t count;
+    uint16_t* values;        // Written values, or filled in for reads; 0/1 per coil/input
+};
+
+// Server handler: return MB_EX_NONE or a Modbus exception code
+typedef ModbusDelegate<uint8_t, ModbusBlock> cbModbus;
+
+// File record range passed to a file handler (one FC20/21 sub-request)
+struct ModbusFileBlock {
+    bool write;
+    uint16_t file;
+    uint16_t record;         // First record (register) number
+    uint16_t count;
+    uint16_t* values;        // Written values, or filled in for reads
+};
+
+// File handler: return MB_EX_NONE or a Modbus exception code
+typedef ModbusDelegate<uint8_t, ModbusFileBlock> cbModbusFile;
+
+class ModbusServer {
+public:
+    ModbusServer();
+
+    /**
+     * Register a handler for a range of one data table
+     * @return false if the range is outside the table, overlaps another
+     *         handler or no handler slot is left
+     */
+    bool addHandler(ModbusRegType type, uint16_t address, uint16_t count, cbModbus cb);
+
+    /**
+     * Register a handler for one file of FC20/21 file records
+     * @param file File number (1-65535)
+     * @return false if the file already has a handler or no slot is left
+     */
+    bool addFileHandler(uint16_t file, cbModbusFile cb);
+
+    /**
+     * Process one request
+     * @param request Request PDU (function code first)
+     * @param length Request PDU length
+     * @param response Buffer of at least MB_MAX_PDU bytes for the response PDU
+     * @return Response PDU length
+     */
+    uint16_t processPdu(const uint8_t* request, uint16_t length, uint8_t* response);
+
+#ifdef MODBUS_BENCHMARK
+    /**
+     * Time a full-range read of every registered handler and print the
+     * average request turnaround
+     */
+    void benchmark(Print& out, uint16_t iterations = 1000);
+#endif
+
+private:
+    struct HandlerSlot {
+        ModbusRegType type;
+        uint16_t address;
+        uint16_t count;
+        cbModbus cb;
+    };
+
+    struct FileSlot {
+        uint16_t file;
+        cbModbusFile cb;
+    };
+
+    HandlerSlot handlers[MB_SERVER_MAX_HANDLERS];
+    uint8_t handlerCount;
+    FileSlot files[MB_SERVER_MAX_FILES];
+    uint8_t fileCount;
+
+    // Handler slot + 1 for every address, 0 = not mapped
+    uint8_t coilIndex[MB_SERVER_BIT_SPACE];
+    uint8_t discreteIndex[MB_SERVER_BIT_SPACE];
+    uint8_t holdingIndex[MB_SERVER_REG_SPACE];
+    uint8_t inputIndex[MB_SERVER_REG_SPACE];
+
+    uint16_t values[MB_SERVER_MAX_VALUES];
+    SemaphoreHandle_t mutex;         // Guards values[] and the handlers
+
+    uint16_t handlePdu(const uint8_t* request, uint16_t length, uint8_t* response);
+    uint8_t* tableIndex(ModbusRegType type, uint16_t& size);
+    uint8_t dispatch(ModbusRegType type, bool write, uint16_t address, uint16_t count);
+    FileSlot* findFile(uint16_t file);
+    uint16_t readFileRecords(const uint8_t* request, uint16_t length, uint8_t* response);
+    uint16_t writeFileRecords(const uint8_t* request, uint16_t length, uint8_t* response);
+    static uint16_t exception(uint8_t function, uint8_t code, uint8_t* response);
+};
+
+#endif // MODBUS_SERVER_H
\ No newline at end of file
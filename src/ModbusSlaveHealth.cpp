@@ -0,0 +1,118 @@
+/**
+ * ModbusSlaveHealth.cpp - Implementation of the per-slave reply timing
+ */
+
+#include "ModbusSlaveHealth.h"
+
+ModbusSlaveHealth::ModbusSlaveHealth() {
+    memset(links, 0, sizeof(links));
+}
+
+ModbusSlaveLink* ModbusSlaveHealth::findLink(uint8_t slaveId, bool create) {
+    if (slaveId == 0) {
+        return nullptr;
+    }
+
+    for (uint8_t i = 0; i < MB_MASTER_MAX_SLAVES; i++) {
+        if (links[i].slaveId == slaveId) {
+            return &links[i];
+        }
+    }
+
+    if (!create) {
+        return nullptr;
+    }
+
+    for (uint8_t i = 0; i < MB_MASTER_MAX_SLAVES; i++) {
+        if (links[i].slaveId == 0) {
+            links[i].slaveId = slaveId;
+            return &links[i];
+        }
+    }
+
+    return nullptr;  // Table full, the slave gets the default timeout
+}
+
+const ModbusSlaveLink* ModbusSlaveHealth::getLink(uint8_t slaveId) const {
+    return const_cast<ModbusSlaveHealth*>(this)->findLink(slaveId, false);
+}
+
+uint16_t ModbusSlaveHealth::timeoutFor(uint8_t slaveId, uint32_t replyMicros) const {
+    const ModbusSlaveLink* link = getLink(slaveId);
+    if (link == nullptr || link->srtt == 0 || link->offline) {
+        return MB_MASTER_DEFAULT_TIMEOUT;
+    }
+
+    uint32_t ms = (link->srtt + 4 * link->rttvar + replyMicros + 999) / 1000;
+    if (ms < MB_MASTER_MIN_TIMEOUT) {
+        return MB_MASTER_MIN_TIMEOUT;
+    }
+    return (ms > MB_MASTER_DEFAULT_TIMEOUT) ? MB_MASTER_DEFAULT_TIMEOUT : ms;
+}
+
+void ModbusSlaveHealth::recordReply(uint8_t slaveId, uint32_t latencyMicros) {
+    ModbusSlaveLink* link = findLink(slaveId, true);
+    if (link == nullptr) {
+        return;
+    }
+
+    link->failures = 0;
+    link->offline = false;
+    if (latencyMicros == 0) {
+        return;
+    }
+
+    if (link->srtt == 0) {
+        link->srtt = latencyMicros;
+        link->rttvar = latencyMicros / 2;
+        return;
+    }
+
+    int32_t error = (int32_t)latencyMicros - (int32_t)link->srtt;
+    int32_t deviation = (error < 0) ? -error : error;
+    link->rttvar = (int32_t)link->rttvar + (deviation - (int32_t)link->rttvar) / 4;
+    link->srtt = (int32_t)link->srtt + error / 8;
+    if (link->srtt == 0) {
+        link->srtt = 1;
+    }
+}
+
+bool ModbusSlaveHealth::recordFailure(uint8_t slaveId) {
+    ModbusSlaveLink* link = findLink(slaveId, true);
+    if (link == nullptr) {
+        return false;
+    }
+
+    if (link->failures < 0xFF) {
+        link->failures++;
+    }
+    if (link->offline) {
+        return false;  // Failed probe, admit() has already set the next one
+    }
+    if (link->failures < MB_MASTER_OFFLINE_AFTER) {
+        return false;
+    }
+
+    link->offline = true;
+    link->nextProbe = millis() + MB_MASTER_PROBE_INTERVAL;
+    return true;
+}
+
+bool ModbusSlaveHealth::admit(uint8_t slaveId) {
+    ModbusSlaveLink* link = findLink(slaveId, false);
+    if (link == nullptr || !link->offline) {
+        return true;
+    }
+
+    if ((long)(millis() - link->nextProbe) < 0) {
+        return false;
+    }
+
+    link->nextProbe = millis() + MB_MASTER_PROBE_INTERVAL;
+    return true;
+}
+
+bool ModbusSlaveHealth::isOffline(uint8_t slaveId) const {
+    const ModbusSlaveLink* link = getLink(slaveId);
+    return link != nullptr && link->offline;
+}
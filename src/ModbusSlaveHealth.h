@@ -0,0 +1,77 @@
+/**
+ * ModbusSlaveHealth.h - Per-slave reply timing for the Cortex Link A8R-M ESP32 IoT Smart Home Controller
+ *
+ * Tracks how fast each RS485 slave answers and whether it answers at all.
+ * The latency (end of request to start of reply, i.e. round trip minus
+ * the reply's own transmission time) is smoothed as in TCP:
+ *   srtt   += (sample - srtt) / 8
+ *   rttvar += (|sample - srtt| - rttvar) / 4
+ * and a request waits srtt + 4 * rttvar plus the transmission time of
+ * its expected reply, within MB_MASTER_MIN_TIMEOUT and
+ * MB_MASTER_DEFAULT_TIMEOUT. A slave that fails MB_MASTER_OFFLINE_AFTER
+ * requests in a row (after retries) is marked offline: its requests then
+ * fail at once, except one probe every MB_MASTER_PROBE_INTERVAL ms.
+ */
+
+#ifndef MODBUS_SLAVE_HEALTH_H
+#define MODBUS_SLAVE_HEALTH_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Timing state of one slave
+struct ModbusSlaveLink {
+    uint8_t slaveId;             // 0 = slot unused
+    bool offline;
+    uint8_t failures;            // Failed requests in a row
+    uint32_t srtt;               // Smoothed latency in us, 0 = no sample yet
+    uint32_t rttvar;             // Latency deviation in us
+    unsigned long nextProbe;     // millis() of the next probe while offline
+};
+
+class ModbusSlaveHealth {
+public:
+    ModbusSlaveHealth();
+
+    /**
+     * Reply timeout for a request
+     * @param slaveId RS485 slave address
+     * @param replyMicros Transmission time of the expected reply
+     * @return Timeout in ms, counted from the end of the request
+     */
+    uint16_t timeoutFor(uint8_t slaveId, uint32_t replyMicros) const;
+
+    /**
+     * Record an answered request (reply or exception)
+     * @param latencyMicros Round trip minus the reply's transmission time,
+     *        or 0 to only reset the failure count (retried request)
+     */
+    void recordReply(uint8_t slaveId, uint32_t latencyMicros);
+
+    /**
+     * Record a request that failed after all retries
+     * @return true if the slave has just gone offline
+     */
+    bool recordFailure(uint8_t slaveId);
+
+    /**
+     * Whether a request to this slave may go on the bus. For an offline
+     * slave this is true once per MB_MASTER_PROBE_INTERVAL (the probe).
+     */
+    bool admit(uint8_t slaveId);
+
+    bool isOffline(uint8_t slaveId) const;
+
+    /**
+     * Timing state of one slave
+     * @return nullptr if the slave has not been addressed (or no slot was free)
+     */
+    const ModbusSlaveLink* getLink(uint8_t slaveId) const;
+
+private:
+    ModbusSlaveLink links[MB_MASTER_MAX_SLAVES];
+
+    ModbusSlaveLink* findLink(uint8_t slaveId, bool create);
+};
+
+#endif // MODBUS_SLAVE_HEALTH_H
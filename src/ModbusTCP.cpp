@@ -0,0 +1,196 @@
+/**
+ * ModbusTCP.cpp - Implementation of the Modbus TCP server
+ */
+
+#include "ModbusTCP.h"
+#include "Debug.h"
+
+ModbusTCP::ModbusTCP() :
+    tcpServer(MB_TCP_PORT),
+    server(nullptr),
+    gateway(nullptr),
+    started(false)
+{
+    for (uint8_t i = 0; i < MB_TCP_MAX_CLIENTS; i++) {
+        connections[i].active = false;
+        connections[i].rxLength = 0;
+        connections[i].lastActivity = 0;
+    }
+}
+
+void ModbusTCP::begin(ModbusServer& core) {
+    server = &core;
+    tcpServer.begin();
+    started = true;
+    ERROR_LOG("Modbus TCP on %d", MB_TCP_PORT);
+}
+
+void ModbusTCP::setGateway(ModbusGateway& gw) {
+    gateway = &gw;
+    gateway->onResponse([this](uint8_t connection, uint16_t transactionId, uint8_t unitId,
+                               const uint8_t* pdu, uint16_t length) {
+        sendResponse(connection, transactionId, unitId, pdu, length);
+    });
+}
+
+void ModbusTCP::task() {
+    if (!started) {
+        return;
+    }
+
+    acceptClients();
+
+    for (uint8_t i = 0; i < MB_TCP_MAX_CLIENTS; i++) {
+        if (connections[i].active) {
+            serviceConnection(connections[i]);
+        }
+    }
+}
+
+uint8_t ModbusTCP::getClientCount() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < MB_TCP_MAX_CLIENTS; i++) {
+        if (connections[i].active) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void ModbusTCP::acceptClients() {
+    EthernetClient client = tcpServer.accept();
+    if (!client) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < MB_TCP_MAX_CLIENTS; i++) {
+        Connection& conn = connections[i];
+        if (!conn.active) {
+            conn.client = client;
+            conn.active = true;
+            conn.rxLength = 0;
+            conn.lastActivity = millis();
+            return;
+        }
+    }
+
+    // All slots busy
+    client.stop();
+}
+
+void ModbusTCP::closeConnection(Connection& conn) {
+    if (gateway != nullptr) {
+        gateway->dropConnection(&conn - connections);
+    }
+    conn.client.stop();
+    conn.active = false;
+    conn.rxLength = 0;
+}
+
+void ModbusTCP::serviceConnection(Connection& conn) {
+    if (!conn.client.connected()) {
+        closeConnection(conn);
+        return;
+    }
+
+    int available = conn.client.available();
+    if (available > 0) {
+        uint16_t space = sizeof(conn.rx) - conn.rxLength;
+        int n = conn.client.read(&conn.rx[conn.rxLength], (available < space) ? available : space);
+        if (n > 0) {
+            conn.rxLength += n;
+            conn.lastActivity = millis();
+        }
+    }
+
+    // Answer every complete request waiting in the buffer
+    uint16_t consumed = 0;
+    uint16_t txLength = 0;
+    uint8_t answered = 0;
+
+    while (answered < MB_TCP_PIPELINE && conn.rxLength - consumed >= 7) {
+        const uint8_t* adu = &conn.rx[consumed];
+        uint16_t protocol = (adu[2] << 8) | adu[3];
+        uint16_t length = (adu[4] << 8) | adu[5];   // Unit ID + PDU
+
+        if (protocol != 0 || length < 2 || length > MB_MAX_PDU + 1) {
+            // Not Modbus, the stream cannot be resynchronized
+            closeConnection(conn);
+            return;
+        }
+
+        if (conn.rxLength - consumed < 6 + length) {
+            break;  // Rest of the request still in flight
+        }
+
+        txLength += processAdu(&conn - connections, adu, length - 1, &txBuffer[txLength]);
+        consumed += 6 + length;
+        answered++;
+    }
+
+    // One socket write for all responses of this pass
+    if (txLength > 0) {
+        conn.client.write(txBuffer, txLength);
+    }
+
+    if (consumed > 0) {
+        memmove(conn.rx, &conn.rx[consumed], conn.rxLength - consumed);
+        conn.rxLength -= consumed;
+    }
+
+    if (millis() - conn.lastActivity > MB_TCP_IDLE_TIMEOUT) {
+        closeConnection(conn);
+    }
+}
+
+uint16_t ModbusTCP::processAdu(uint8_t connection, const uint8_t* adu, uint16_t pduLength, uint8_t* response) {
+    uint8_t unitId = adu[6];
+    uint16_t length;
+
+    if (unitId == MB_SERVER_ID || unitId == 0 || unitId == 0xFF) {
+        length = server->processPdu(&adu[7], pduLength, &response[7]);
+    }
+    else {
+        uint8_t ex = MB_EX_GATEWAY_PATH;
+        if (gateway != nullptr) {
+            uint16_t transactionId = (adu[0] << 8) | adu[1];
+            ex = gateway->enqueue(connection, transactionId, unitId, &adu[7], pduLength);
+            if (ex == MB_EX_NONE) {
+                return 0;  // Answered by sendResponse() once the slave replies
+            }
+        }
+        response[7] = adu[7] | 0x80;
+        response[8] = ex;
+        length = 2;
+    }
+
+    // MBAP header: same transaction ID and unit, protocol 0
+    response[0] = adu[0];
+    response[1] = adu[1];
+    response[2] = 0;
+    response[3] = 0;
+    response[4] = (length + 1) >> 8;
+    response[5] = (length + 1) & 0xFF;
+    response[6] = unitId;
+
+    return 7 + length;
+}
+
+void ModbusTCP::sendResponse(uint8_t connection, uint16_t transactionId, uint8_t unitId,
+                             const uint8_t* pdu, uint16_t length) {
+    if (connection >= MB_TCP_MAX_CLIENTS || !connections[connection].active) {
+        return;
+    }
+
+    uint8_t adu[MB_TCP_MAX_ADU];
+    adu[0] = transactionId >> 8;
+    adu[1] = transactionId & 0xFF;
+    adu[2] = 0;
+    adu[3] = 0;
+    adu[4] = (length + 1) >> 8;
+    adu[5] = (length + 1) & 0xFF;
+    adu[6] = unitId;
+    memcpy(&adu[7], pdu, length);
+
+    connections[connection].client.write(adu, 7 + length);
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+/**
+ * ModbusTCP.h - Modbus TCP server on the W5500 for Cortex Link A8R-M ESP32 IoT Smart Home Controller
+ *
+ * Listens on port 502 and serves up to MB_TCP_MAX_CLIENTS connections at
+ * once, each on its own W5500 socket. Requests go to the same ModbusServer
+ * core as the RTU port, so both transports share one register map.
+ * Clients may pipeline several requests; every complete request in the
+ * receive buffer is answered under its own transaction ID. With a gateway
+ * attached, requests for other unit IDs are forwarded to RS485 and
+ * answered when the slave replies.
+ */
+
+#ifndef MODBUS_TCP_H
+#define MODBUS_TCP_H
+
+#include <Arduino.h>
+#include <Ethernet.h>
+#include "Config.h"
+#include "ModbusServer.h"
+#include "ModbusGateway.h"
+
+class ModbusTCP {
+public:
+    ModbusTCP();
+
+    /**
+     * Start listening (call after Ethernet is up)
+     * @param server Server core holding the register handlers
+     */
+    void begin(ModbusServer& server);
+
+    /**
+     * Forward requests for other unit IDs through a TCP-to-RTU gateway
+     */
+    void setGateway(ModbusGateway& gateway);
+
+    /**
+     * Accept connections and answer requests (call this in the loop)
+     */
+    void task();
+
+    /**
+     * Number of open client connections
+     */
+    uint8_t getClientCount() const;
+
+private:
+    struct Connection {
+        EthernetClient client;
+        bool active;
+        uint8_t rx[MB_TCP_MAX_ADU * 2];
+        uint16_t rxLength;
+        unsigned long lastActivity;
+    };
+
+    EthernetServer tcpServer;
+    ModbusServer* server;
+    ModbusGateway* gateway;
+    bool started;
+    Connection connections[MB_TCP_MAX_CLIENTS];
+    uint8_t txBuffer[MB_TCP_MAX_ADU * MB_TCP_PIPELINE];
+
+    void acceptClients();
+    void serviceConnection(Connection& conn);
+    void closeConnection(Connection& conn);
+    uint16_t processAdu(uint8_t connection, const uint8_t* adu, uint16_t pduLength, uint8_t* response);
+    void sendResponse(uint8_t connection, uint16_t transactionId, uint8_t unitId,
+                      const uint8_t* pdu, uint16_t length);
+};
+
+#endif // MODBUS_TCP_H
\ No newline at end of file
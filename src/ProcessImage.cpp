@@ -0,0 +1,297 @@
+/**
+ * ProcessImage.cpp - Implementation of the double-buffered process image
+ */
+
+#include "ProcessImage.h"
+
+#if MAX_DS18B20_SENSORS > 8
+#error "The packed board window holds 8 DS18B20 temperatures"
+#endif
+
+ProcessImage::ProcessImage() :
+    digitalInputs(nullptr),
+    relayOutputs(nullptr),
+    analogInputs(nullptr),
+    dacControl(nullptr),
+    dhtSensors(nullptr),
+    front(0),
+    lastAcquisition(0),
+    refreshRequested(false),
+    writeHead(0),
+    writeCount(0)
+{
+    memset(buffers, 0, sizeof(buffers));
+}
+
+void ProcessImage::begin(DigitalInputs& di, RelayOutputs& relays, AnalogInputs& analog,
+                         DACControl& dac, DHTSensors& sensors) {
+    digitalInputs = &di;
+    relayOutputs = &relays;
+    analogInputs = &analog;
+    dacControl = &dac;
+    dhtSensors = &sensors;
+
+    acquire();
+}
+
+void ProcessImage::task() {
+    if (digitalInputs == nullptr) {
+        return;
+    }
+
+    // Outputs first, so the next snapshot already shows them
+    bool wrote = writeCount > 0;
+    applyWrites();
+
+    unsigned long now = millis();
+    if (wrote || refreshRequested || now - lastAcquisition >= PROCESS_IMAGE_INTERVAL) {
+        refreshRequested = false;
+        acquire();
+    }
+}
+
+void ProcessImage::acquire() {
+    ProcessImageData& back = buffers[front ^ 1];
+
+    // One port read covers all 8 inputs, behind any output write
+    back.inputs = digitalInputs->readAllInputs(I2C_PRIO_LOW);
+    back.relays = relayOutputs->getAllRelayStates();
+
+    for (uint8_t i = 0; i < NUM_ANALOG_CHANNELS; i++) {
+        back.voltages[i] = analogInputs->readVoltage(i);
+    }
+    for (uint8_t i = 0; i < NUM_CURRENT_CHANNELS; i++) {
+        back.currents[i] = analogInputs->readCurrent(i);
+    }
+
+    // DHT and DS18B20 values are already cached by DHTSensors::update()
+    back.dhtConnected = 0;
+    for (uint8_t i = 0; i < NUM_DHT_SENSORS; i++) {
+        back.temperatures[i] = dhtSensors->getTemperature(i);
+        back.humidities[i] = dhtSensors->getHumidity(i);
+        if (dhtSensors->isSensorConnected(i)) {
+            back.dhtConnected |= (1 << i);
+        }
+    }
+
+    back.ds18b20Count = dhtSensors->getDS18B20Count();
+    for (uint8_t i = 0; i < MAX_DS18B20_SENSORS; i++) {
+        back.ds18b20Temps[i] = dhtSensors->getDS18B20Temperature(i);
+    }
+
+    for (uint8_t i = 0; i < 2; i++) {
+        back.dacVoltages[i] = dacControl->getVoltage(i);
+        back.dacCurrents[i] = dacControl->getCurrent(i);
+    }
+
+    lastAcquisition = millis();
+    back.timestamp = lastAcquisition;
+    back.sequence = buffers[front].sequence + 1;
+    packBoardWindow(back);
+
+    // The change counter only moves when a published value differs, so a
+    // poller can skip reading an unchanged window. Single ADC samples
+    // jitter by a few counts, so an analog input keeps its published value
+    // until it moves by more than the deadband.
+    const uint16_t* previous = buffers[front].boardWindow;
+    for (uint8_t i = 0; i < NUM_ANALOG_CHANNELS + NUM_CURRENT_CHANNELS; i++) {
+        uint16_t& value = back.boardWindow[MB_BOARD_ANALOG + i];
+        uint16_t published = previous[MB_BOARD_ANALOG + i];
+        uint16_t delta = (value > published) ? value - published : published - value;
+        if (delta <= MB_BOARD_ANALOG_DEADBAND) {
+            value = published;
+        }
+    }
+
+    // Publish the new snapshot
+    portENTER_CRITICAL(&lock);
+
+    // Relay writes queued since the relays were read have already patched
+    // the front buffer. Carry them over, or the swap would undo them.
+    for (uint8_t i = 0; i < writeCount; i++) {
+        const WriteCommand& cmd = writeQueue[(writeHead + i) % PROCESS_IMAGE_WRITE_QUEUE];
+        if (cmd.type == PI_WRITE_RELAY) {
+            back.relays = (back.relays & ~cmd.index) | cmd.value;
+        }
+    }
+    back.boardWindow[MB_BOARD_RELAYS] = back.relays;
+
+    // Compared under the lock too, so a patch's counter step is kept
+    bool changed = back.boardWindow[MB_BOARD_STATUS] != previous[MB_BOARD_STATUS] ||
+                   back.boardWindow[MB_BOARD_QUALITY] != previous[MB_BOARD_QUALITY] ||
+                   memcmp(&back.boardWindow[MB_BOARD_INPUTS], &previous[MB_BOARD_INPUTS],
+                          (MB_BOARD_CHANGES - MB_BOARD_INPUTS) * sizeof(uint16_t)) != 0;
+    back.boardWindow[MB_BOARD_CHANGES] = previous[MB_BOARD_CHANGES] + (changed ? 1 : 0);
+
+    front ^= 1;
+    portEXIT_CRITICAL(&lock);
+}
+
+bool ProcessImage::queueRelay(uint8_t relayNum, bool state) {
+    if (relayNum >= NUM_RELAY_OUTPUTS) {
+        return false;
+    }
+
+    return queueRelays(1 << relayNum, state ? (1 << relayNum) : 0);
+}
+
+bool ProcessImage::queueRelays(uint8_t mask, uint8_t states) {
+    mask &= (1 << NUM_RELAY_OUTPUTS) - 1;
+    if (mask == 0) {
+        return false;
+    }
+    states &= mask;
+
+    portENTER_CRITICAL(&lock);
+    bool queued;
+    WriteCommand* last = writeCount ? &writeQueue[(writeHead + writeCount - 1) % PROCESS_IMAGE_WRITE_QUEUE] : nullptr;
+    if (last && last->type == PI_WRITE_RELAY) {
+        // Fold into the relay command at the tail, so back-to-back
+        // relay writes still cost one port write
+        last->index |= mask;
+        last->value = (last->value & ~mask) | states;
+        queued = true;
+    } else {
+        queued = pushWrite(PI_WRITE_RELAY, mask, states);
+    }
+    if (queued) {
+        // Reads that follow the write see the requested state straight away
+        ProcessImageData& image = buffers[front];
+        image.relays = (image.relays & ~mask) | states;
+        image.boardWindow[MB_BOARD_RELAYS] = image.relays;
+        image.boardWindow[MB_BOARD_CHANGES]++;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    return queued;
+}
+
+bool ProcessImage::queueDac(uint8_t channel, ProcessImageWrite type, uint16_t value) {
+    return queueDacs(channel, 1, type, &value);
+}
+
+bool ProcessImage::queueDacs(uint8_t first, uint8_t count, ProcessImageWrite type, const uint16_t* values) {
+    if (count == 0 || first + count > 2 || type == PI_WRITE_RELAY) {
+        return false;
+    }
+
+    // All channels or none, so a multi-register write is never half applied
+    portENTER_CRITICAL(&lock);
+    bool queued = writeCount + count <= PROCESS_IMAGE_WRITE_QUEUE;
+    for (uint8_t i = 0; queued && i < count; i++) {
+        pushWrite(type, first + i, values[i]);
+    }
+    portEXIT_CRITICAL(&lock);
+
+    return queued;
+}
+
+// Called with the lock held
+bool ProcessImage::pushWrite(ProcessImageWrite type, uint8_t index, uint16_t value) {
+    if (writeCount >= PROCESS_IMAGE_WRITE_QUEUE) {
+        return false;
+    }
+
+    WriteCommand& cmd = writeQueue[(writeHead + writeCount) % PROCESS_IMAGE_WRITE_QUEUE];
+    cmd.type = type;
+    cmd.index = index;
+    cmd.value = value;
+    writeCount++;
+
+    return true;
+}
+
+void ProcessImage::applyWrites() {
+    while (writeCount > 0) {
+        // Take the command out under the lock, drive the hardware outside it
+        portENTER_CRITICAL(&lock);
+        WriteCommand cmd = writeQueue[writeHead];
+        writeHead = (writeHead + 1) % PROCESS_IMAGE_WRITE_QUEUE;
+        writeCount--;
+        portEXIT_CRITICAL(&lock);
+
+        switch (cmd.type) {
+            case PI_WRITE_RELAY:
+                relayOutputs->setRelays(cmd.index, cmd.value);
+                break;
+            case PI_WRITE_DAC_VOLTAGE:
+                dacControl->setVoltage(cmd.index, cmd.value / 1000.0);
+                break;
+            case PI_WRITE_DAC_CURRENT:
+                dacControl->setCurrent(cmd.index, cmd.value / 1000.0);
+                break;
+        }
+    }
+}
+
+void ProcessImage::packBoardWindow(ProcessImageData& image) {
+    uint16_t* w = image.boardWindow;
+
+    uint16_t quality = image.dhtConnected;
+    for (uint8_t i = 0; i < image.ds18b20Count; i++) {
+        if (image.ds18b20Temps[i] > -127.0) {
+            quality |= (1 << (8 + i));
+        }
+    }
+
+    w[MB_BOARD_STATUS] = (image.ds18b20Count > 0) ? MB_BOARD_STATUS_DS18B20 : 0;
+    w[MB_BOARD_QUALITY] = quality;
+    w[MB_BOARD_SEQUENCE] = image.sequence & 0xFFFF;
+    w[MB_BOARD_AGE] = 0;
+    w[MB_BOARD_INPUTS] = image.inputs;
+    w[MB_BOARD_RELAYS] = image.relays;
+
+    for (uint8_t i = 0; i < NUM_ANALOG_CHANNELS; i++) {
+        w[MB_BOARD_ANALOG + i] = (uint16_t)(image.voltages[i] * 1000);
+    }
+    for (uint8_t i = 0; i < NUM_CURRENT_CHANNELS; i++) {
+        w[MB_BOARD_ANALOG + NUM_ANALOG_CHANNELS + i] = (uint16_t)(image.currents[i] * 1000);
+    }
+
+    // Temperatures are signed so sub-zero values survive the round trip
+    for (uint8_t i = 0; i < NUM_DHT_SENSORS; i++) {
+        w[MB_BOARD_TEMP + i] = (uint16_t)(int16_t)(image.temperatures[i] * 10);
+        w[MB_BOARD_HUM + i] = (uint16_t)(image.humidities[i] * 10);
+    }
+
+    w[MB_BOARD_DS18B20_COUNT] = image.ds18b20Count;
+    for (uint8_t i = 0; i < MAX_DS18B20_SENSORS; i++) {
+        w[MB_BOARD_DS18B20 + i] = (i < image.ds18b20Count) ? (uint16_t)(int16_t)(image.ds18b20Temps[i] * 10) : 0;
+    }
+
+    for (uint8_t i = 0; i < 2; i++) {
+        w[MB_BOARD_DAC + i * 2] = (uint16_t)(image.dacVoltages[i] * 1000);
+        w[MB_BOARD_DAC + i * 2 + 1] = (uint16_t)(image.dacCurrents[i] * 1000);
+    }
+}
+
+void ProcessImage::readBoardWindow(uint16_t offset, uint16_t count, uint16_t* values) const {
+    const ProcessImageData& image = buffers[front];
+    unsigned long age = millis() - image.timestamp;
+
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t index = offset + i;
+        if (index >= MB_BOARD_WINDOW_SIZE) {
+            values[i] = 0;
+            continue;
+        }
+
+        switch (index) {
+            case MB_BOARD_STATUS:
+                values[i] = image.boardWindow[index];
+                if (age < 2 * PROCESS_IMAGE_INTERVAL) {
+                    values[i] |= MB_BOARD_STATUS_FRESH;
+                }
+                if (writeCount > 0) {
+                    values[i] |= MB_BOARD_STATUS_PENDING;
+                }
+                break;
+            case MB_BOARD_AGE:
+                values[i] = (age > 0xFFFF) ? 0xFFFF : age;
+                break;
+            default:
+                values[i] = image.boardWindow[index];
+                break;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+/**
+ * ProcessImage.h - Double-buffered process image for Cortex Link A8R-M ESP32 IoT Smart Home Controller
+ *
+ * A periodic acquisition pass reads every input once into the back buffer
+ * and then swaps it to the front. Modbus callbacks read the front buffer
+ * only, so serving a register never touches I2C or the ADC. Writes from
+ * the bus are queued and applied to the output drivers from task().
+ * The write queue and the buffer swap are guarded by a spinlock, so the
+ * Modbus handlers may run in another task than task().
+ */
+
+#ifndef PROCESS_IMAGE_H
+#define PROCESS_IMAGE_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "DigitalInputs.h"
+#include "RelayOutputs.h"
+#include "AnalogInputs.h"
+#include "DACControl.h"
+#include "DHT_Sensors.h"
+
+// One consistent snapshot of the board
+struct ProcessImageData {
+    uint8_t inputs;                                 // Digital input bits, 1 = active
+    uint8_t relays;                                 // Relay state bits, 1 = on
+    float voltages[NUM_ANALOG_CHANNELS];            // 0-5V inputs in V
+    float currents[NUM_CURRENT_CHANNELS];           // 4-20mA inputs in mA
+    float temperatures[NUM_DHT_SENSORS];            // DHT22 in degC
+    float humidities[NUM_DHT_SENSORS];              // DHT22 in %RH
+    uint8_t dhtConnected;                           // Bit per DHT22 with a valid reading
+    uint8_t ds18b20Count;
+    float ds18b20Temps[MAX_DS18B20_SENSORS];        // degC
+    float dacVoltages[2];                           // Last set DAC outputs
+    float dacCurrents[2];
+    unsigned long timestamp;                        // millis() of the acquisition
+    uint32_t sequence;                              // Incremented on every swap
+    uint16_t boardWindow[MB_BOARD_WINDOW_SIZE];     // Pre-encoded packed register window
+};
+
+// Output write queued from the bus
+enum ProcessImageWrite {
+    PI_WRITE_RELAY,             // index = relay mask, value = relay states
+    PI_WRITE_DAC_VOLTAGE,
+    PI_WRITE_DAC_CURRENT
+};
+
+class ProcessImage {
+public:
+    ProcessImage();
+
+    /**
+     * Attach the I/O modules and take the first snapshot
+     */
+    void begin(DigitalInputs& di, RelayOutputs& relays, AnalogInputs& analog,
+               DACControl& dac, DHTSensors& sensors);
+
+    /**
+     * Apply queued writes and refresh the image when due (call this in the loop)
+     */
+    void task();
+
+    /**
+     * Force an acquisition on the next task() call (e.g. after a DI interrupt)
+     */
+    void requestRefresh() { refreshRequested = true; }
+
+    /**
+     * Current front buffer. Reading it never touches the hardware.
+     */
+    const ProcessImageData& snapshot() const { return buffers[front]; }
+
+    /**
+     * Copy part of the packed board window (see MB_BOARD_* in Config.h)
+     * with live status and age words
+     * @param offset First register relative to MB_REG_BOARD_START
+     * @param count Number of registers
+     * @param values Destination
+     */
+    void readBoardWindow(uint16_t offset, uint16_t count, uint16_t* values) const;
+
+    /**
+     * Number of output writes not yet applied
+     */
+    uint8_t pendingWrites() const { return writeCount; }
+
+    /**
+     * Queue a relay change
+     * @return false if the relay number is invalid or the queue is full
+     */
+    bool queueRelay(uint8_t relayNum, bool state);
+
+    /**
+     * Queue a change of several relays, applied in one MCP23017 port write
+     * @param mask Relays to change (bit n = relay n)
+     * @param states New states of the relays in mask
+     * @return false if the mask holds no valid relay or the queue is full
+     */
+    bool queueRelays(uint8_t mask, uint8_t states);
+
+    /**
+     * Queue a DAC change
+     * @param channel DAC channel (0-1)
+     * @param type PI_WRITE_DAC_VOLTAGE (value in mV) or PI_WRITE_DAC_CURRENT (value in uA)
+     * @return false if the channel is invalid or the queue is full
+     */
+    bool queueDac(uint8_t channel, ProcessImageWrite type, uint16_t value);
+
+    /**
+     * Queue changes of consecutive DAC channels, all of them or none
+     * @param first First DAC channel (0-1)
+     * @param count Number of channels
+     * @param values One value per channel, in mV or uA as for queueDac()
+     * @return false if a channel is invalid or the queue has no room for all
+     */
+    bool queueDacs(uint8_t first, uint8_t count, ProcessImageWrite type, const uint16_t* values);
+
+private:
+    struct WriteCommand {
+        ProcessImageWrite type;
+        uint8_t index;
+        uint16_t value;
+    };
+
+    DigitalInputs* digitalInputs;
+    RelayOutputs* relayOutputs;
+    AnalogInputs* analogInputs;
+    DACControl* dacControl;
+    DHTSensors* dhtSensors;
+
+    ProcessImageData buffers[2];
+    volatile uint8_t front;
+    unsigned long lastAcquisition;
+    bool refreshRequested;
+
+    WriteCommand writeQueue[PROCESS_IMAGE_WRITE_QUEUE];
+    uint8_t writeHead;
+    volatile uint8_t writeCount;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    bool pushWrite(ProcessImageWrite type, uint8_t index, uint16_t value);
+    void applyWrites();
+    void acquire();
+    static void packBoardWindow(ProcessImageData& image);
+};
+
+#endif // PROCESS_IMAGE_H
\ No newline at end of file
@@ -0,0 +1,131 @@
+/**
+ * RS485Port.cpp - Implementation of the RS485 half-duplex UART driver
+ */
+
+#include "RS485Port.h"
+#include "Debug.h"
+
+RS485Port::RS485Port(HardwareSerial& port) :
+    serial(port),
+    charMicros(0),
+    txDoneMicros(0),
+    busFreeMicros(0),
+    lastRxEventMicros(0),
+    frameEnds(0),
+    frameEndsSeen(0),
+    overruns(0),
+    notifyTask(nullptr),
+    gapMicros(0)
+{
+}
+
+void RS485Port::setTiming(unsigned long baudRate) {
+    // 1 start + 8 data + parity/stop = 11 bits per character
+    charMicros = (11000000UL + baudRate - 1) / baudRate;
+
+    // 3.5 characters, fixed at 1750us above 19200 baud
+    gapMicros = (baudRate > 19200) ? 1750 : (charMicros * 7 + 1) / 2;
+}
+
+bool RS485Port::begin(unsigned long baudRate, int8_t rxPin, int8_t txPin, int8_t dePin) {
+    setTiming(baudRate);
+
+    // Room for several back-to-back frames if the loop is late
+    serial.setRxBufferSize(MB_RTU_RX_BUFFER);
+    serial.begin(baudRate, SERIAL_8N1, rxPin, txPin);
+
+    // RTS drives DE/RE for exactly the duration of each transmission
+    bool ok = serial.setPins(-1, -1, -1, dePin);
+    ok = ok && serial.setMode(UART_MODE_RS485_HALF_DUPLEX);
+
+    // A gap of MB_RTU_RX_TIMEOUT_SYMBOLS characters ends a frame
+    ok = ok && serial.setRxTimeout(MB_RTU_RX_TIMEOUT_SYMBOLS);
+
+    // Runs in the UART event task, only counts the event
+    serial.onReceive([this]() {
+        lastRxEventMicros = micros();
+        frameEnds++;
+        TaskHandle_t task = notifyTask;
+        if (task != nullptr) {
+            xTaskNotifyGive(task);
+        }
+    }, true);
+
+    serial.onReceiveError([this](hardwareSerial_error_t error) {
+        if (error == UART_BUFFER_FULL_ERROR || error == UART_FIFO_OVF_ERROR) {
+            overruns++;
+        }
+    });
+
+    if (!ok) {
+        ERROR_LOG("RS485 UART setup failed");
+    }
+
+    return ok;
+}
+
+void RS485Port::setBaudRate(unsigned long baudRate) {
+    setTiming(baudRate);
+    serial.updateBaudRate(baudRate);
+
+    // Bytes received at the old rate are garbage now
+    discard();
+}
+
+uint16_t RS485Port::read(uint8_t* buffer, uint16_t maxLength) {
+    uint16_t length = 0;
+    bool dropped = false;
+    int count;
+    while ((count = serial.available()) > 0) {
+        if (length < maxLength) {
+            uint16_t space = maxLength - length;
+            length += serial.read(&buffer[length], (count < space) ? count : space);
+        }
+        else {
+            serial.read();  // Frame too long for the buffer
+            dropped = true;
+        }
+    }
+
+    if (dropped) {
+        overruns++;
+    }
+    return length;
+}
+
+void RS485Port::discard() {
+    while (serial.available() > 0) {
+        serial.read();
+    }
+    frameEndsSeen = frameEnds;
+}
+
+bool RS485Port::takeFrameEnd() {
+    uint32_t ends = frameEnds;
+    if (ends == frameEndsSeen) {
+        return false;
+    }
+    frameEndsSeen = ends;
+    return true;
+}
+
+void RS485Port::write(const uint8_t* data, uint16_t length) {
+    // Events from before this frame belong to the previous exchange
+    frameEndsSeen = frameEnds;
+
+    // The UART driver buffers the frame, only the wire time is tracked
+    unsigned long now = micros();
+    long queued = (long)(txDoneMicros - now);
+    unsigned long start = (queued > 0) ? txDoneMicros : now;
+
+    serial.write(data, length);
+
+    txDoneMicros = start + length * charMicros;
+    busFreeMicros = txDoneMicros + gapMicros;
+}
+
+bool RS485Port::isBusIdle() const {
+    unsigned long now = micros();
+    return (long)(now - busFreeMicros) >= 0 &&
+           now - lastRxEventMicros >= gapMicros;
+}
\ No newline at end of file
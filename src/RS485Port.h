@@ -0,0 +1,123 @@
+/**
+ * RS485Port.h - RS485 half-duplex UART driver for Cortex Link A8R-M ESP32 IoT Smart Home Controller
+ *
+ * Runs the ESP32 UART in RS485 half-duplex mode: the UART drives the
+ * MAX485 DE/RE line through its RTS output for exactly the length of each
+ * transmission, so no GPIO toggling or flush() is needed. The end of every
+ * received frame is detected by the UART RX timeout interrupt after
+ * MB_RTU_RX_TIMEOUT_SYMBOLS idle characters, independent of how often the
+ * loop polls the port. Received bytes are collected in the UART driver's
+ * ring buffer (the ESP32 UART has no DMA in the Arduino core).
+ */
+
+#ifndef RS485_PORT_H
+#define RS485_PORT_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+class RS485Port {
+public:
+    RS485Port(HardwareSerial& serial);
+
+    /**
+     * Start the UART in RS485 half-duplex mode
+     * @param baudRate 1200 to 921600 baud
+     * @param rxPin UART RX (MAX485 RO)
+     * @param txPin UART TX (MAX485 DI)
+     * @param dePin MAX485 DE/RE, driven by the UART as RTS
+     * @return true if the UART accepted the RS485 configuration
+     */
+    bool begin(unsigned long baudRate, int8_t rxPin, int8_t txPin, int8_t dePin);
+
+    /**
+     * Change the baud rate of the running port, pins and RS485 mode stay.
+     * Only call this while nothing is being sent or received.
+     */
+    void setBaudRate(unsigned long baudRate);
+
+    /**
+     * Number of received bytes waiting in the ring buffer
+     */
+    int available() { return serial.available(); }
+
+    /**
+     * Read the received bytes, anything beyond maxLength is dropped
+     * @return Number of bytes copied
+     */
+    uint16_t read(uint8_t* buffer, uint16_t maxLength);
+
+    /**
+     * Drop everything received so far, including pending end-of-frame events
+     */
+    void discard();
+
+    /**
+     * Check for a hardware end-of-frame event
+     * @return true once per RX timeout seen since the last call
+     */
+    bool takeFrameEnd();
+
+    /**
+     * Queue a frame for transmission, returns without waiting for the wire
+     */
+    void write(const uint8_t* data, uint16_t length);
+
+    /**
+     * True once the last transmission has left the wire and the bus has
+     * been quiet for 3.5 characters
+     */
+    bool isBusIdle() const;
+
+    /**
+     * micros() when the last transmission finishes on the wire
+     */
+    unsigned long getTxDoneMicros() const { return txDoneMicros; }
+
+    /**
+     * Duration of one 11-bit character in microseconds
+     */
+    unsigned long getCharMicros() const { return charMicros; }
+
+    /**
+     * UART FIFO/ring buffer overruns plus frames cut at maxLength by read()
+     */
+    uint32_t getOverrunCount() const { return overruns; }
+
+    /**
+     * micros() of the last hardware end-of-frame event
+     */
+    unsigned long getFrameEndMicros() const { return lastRxEventMicros; }
+
+    /**
+     * Wake a task on every end-of-frame event
+     * @param task Task to notify (xTaskNotifyGive), nullptr to stop
+     */
+    void setNotifyTask(TaskHandle_t task) { notifyTask = task; }
+
+    /**
+     * Inter-frame gap (3.5 characters, 1750us above 19200 baud)
+     */
+    unsigned long getFrameGapMicros() const { return gapMicros; }
+
+    /**
+     * Underlying serial port
+     */
+    HardwareSerial& getSerial() { return serial; }
+
+private:
+    HardwareSerial& serial;
+    unsigned long charMicros;
+    unsigned long txDoneMicros;      // Last transmitted bit leaves the wire
+    unsigned long busFreeMicros;     // Earliest start of the next frame
+    volatile unsigned long lastRxEventMicros;
+    volatile uint32_t frameEnds;     // Incremented from the UART event task
+    uint32_t frameEndsSeen;
+    volatile uint32_t overruns;
+    TaskHandle_t volatile notifyTask;
+    unsigned long gapMicros;         // 3.5 characters
+
+    void setTiming(unsigned long baudRate);
+};
+
+#endif // RS485_PORT_H
\ No newline at end of file
@@ -0,0 +1,233 @@
+/**
+ * RegisterMap.cpp - Implementation of the Modbus register map
+ */
+
+#include "RegisterMap.h"
+
+// Scaled value as a register, negative values in two's complement
+static inline uint16_t toRegister(float value, uint16_t scale) {
+    return (uint16_t)(int32_t)(value * scale);
+}
+
+// The two registers of a 32-bit value, in wire order
+static inline void splitWords(uint32_t raw, uint16_t* words) {
+#ifdef MB_WORD_LOW_FIRST
+    words[0] = raw & 0xFFFF;
+    words[1] = raw >> 16;
+#else
+    words[0] = raw >> 16;
+    words[1] = raw & 0xFFFF;
+#endif
+}
+
+RegisterMap::RegisterMap() :
+    comm(nullptr),
+    image(nullptr),
+    bus(nullptr)
+{
+}
+
+bool RegisterMap::begin(ModbusComm& modbus, ProcessImage& processImage, I2CBus& i2c) {
+    comm = &modbus;
+    image = &processImage;
+    bus = &i2c;
+
+    bool ok = true;
+    for (uint8_t i = 0; i < REGISTER_MAP_SIZE; i++) {
+        const RegisterEntry& entry = registerMap[i];
+        bindings[i].map = this;
+        bindings[i].entry = &entry;
+        cbModbus cb(&RegisterMap::handleEntry, &bindings[i]);
+
+        switch (entry.type) {
+            case MB_COIL:
+                ok &= comm->addCoilHandler(entry.address, entry.count, cb);
+                break;
+            case MB_DISCRETE_INPUT:
+                ok &= comm->addDiscreteInputHandler(entry.address, entry.count, cb);
+                break;
+            case MB_HOLDING_REG:
+                ok &= comm->addHoldingRegisterHandler(entry.address, entry.count, cb);
+                break;
+            case MB_INPUT_REG:
+                ok &= comm->addInputRegisterHandler(entry.address, entry.count, cb);
+                break;
+        }
+    }
+
+    return ok;
+}
+
+uint8_t RegisterMap::handleEntry(void* context, ModbusBlock& block) {
+    EntryBinding* binding = static_cast<EntryBinding*>(context);
+    return binding->map->handle(*binding->entry, block);
+}
+
+uint8_t RegisterMap::handle(const RegisterEntry& entry, ModbusBlock& block) {
+    if (block.write) {
+        return (entry.access == REG_READ_WRITE) ? write(entry, block) : MB_EX_ILLEGAL_FUNCTION;
+    }
+
+    const ProcessImageData& data = image->snapshot();
+    if (entry.encoding != REG_U16) {
+        readWide(entry, block, data);
+        return MB_EX_NONE;
+    }
+
+    uint16_t* values = block.values;
+    uint8_t first = entry.index + block.offset;
+
+    // One switch per request, each case a straight loop
+    switch (entry.source) {
+        case SRC_INPUT:
+            for (uint16_t i = 0; i < block.count; i++) {
+                values[i] = (data.inputs >> (first + i)) & 0x01;
+            }
+            break;
+
+        case SRC_RELAY:
+            for (uint16_t i = 0; i < block.count; i++) {
+                values[i] = (data.relays >> (first + i)) & 0x01;
+            }
+            break;
+
+        case SRC_VOLTAGE:
+            for (uint16_t i = 0; i < block.count; i++) {
+                values[i] = toRegister(data.voltages[first + i], entry.scale);
+            }
+            break;
+
+        case SRC_CURRENT:
+            for (uint16_t i = 0; i < block.count; i++) {
+                values[i] = toRegister(data.currents[first + i], entry.scale);
+            }
+            break;
+
+        case SRC_DHT_TEMPERATURE:
+        case SRC_DHT_HUMIDITY: {
+            const float* source = (entry.source == SRC_DHT_TEMPERATURE) ? data.temperatures : data.humidities;
+            for (uint16_t i = 0; i < block.count; i++) {
+                uint8_t sensor = first + i;
+                values[i] = (data.dhtConnected & (1 << sensor)) ? toRegister(source[sensor], entry.scale) : 0xFFFF;
+            }
+            break;
+        }
+
+        case SRC_DS18B20:
+            for (uint16_t i = 0; i < block.count; i++) {
+                uint8_t sensor = first + i;
+                values[i] = (sensor < data.ds18b20Count) ? toRegister(data.ds18b20Temps[sensor], entry.scale) : 0;
+            }
+            break;
+
+        case SRC_DAC_VOLTAGE:
+            for (uint16_t i = 0; i < block.count; i++) {
+                values[i] = toRegister(data.dacVoltages[first + i], entry.scale);
+            }
+            break;
+
+        case SRC_DAC_CURRENT:
+            for (uint16_t i = 0; i < block.count; i++) {
+                values[i] = toRegister(data.dacCurrents[first + i], entry.scale);
+            }
+            break;
+
+        case SRC_BOARD_WINDOW:
+            image->readBoardWindow(block.offset, block.count, values);
+            break;
+
+        case SRC_DIAGNOSTICS:
+            comm->getDiagnostics().readRegisters(block.offset, block.count, values);
+            break;
+
+        case SRC_I2C_STATS:
+            bus->readStatsWindow(block.offset, block.count, values);
+            break;
+    }
+
+    return MB_EX_NONE;
+}
+
+void RegisterMap::readWide(const RegisterEntry& entry, ModbusBlock& block, const ProcessImageData& data) {
+    uint16_t reg = block.offset;
+    uint16_t end = block.offset + block.count;
+    uint16_t* values = block.values;
+
+    // Each value is read once and split, so both halves of a pair match
+    // even if the front buffer flips during the request. A request may
+    // start or end mid-pair; it then gets just that half.
+    while (reg < end) {
+        uint8_t element = entry.index + reg / 2;
+        bool valid = true;
+        float value = 0;
+
+        switch (entry.source) {
+            case SRC_VOLTAGE:         value = data.voltages[element]; break;
+            case SRC_CURRENT:         value = data.currents[element]; break;
+            case SRC_DHT_TEMPERATURE: value = data.temperatures[element]; valid = data.dhtConnected & (1 << element); break;
+            case SRC_DHT_HUMIDITY:    value = data.humidities[element]; valid = data.dhtConnected & (1 << element); break;
+            case SRC_DS18B20:         value = data.ds18b20Temps[element]; valid = element < data.ds18b20Count && value > -127.0; break;
+            case SRC_DAC_VOLTAGE:     value = data.dacVoltages[element]; break;
+            case SRC_DAC_CURRENT:     value = data.dacCurrents[element]; break;
+            default:                  valid = false; break;
+        }
+
+        uint32_t raw;
+        if (entry.encoding == REG_FLOAT32) {
+            if (!valid) {
+                value = NAN;
+            }
+            memcpy(&raw, &value, sizeof(raw));
+        } else {
+            raw = valid ? (uint32_t)(int32_t)(value * entry.scale) : 0x80000000UL;
+        }
+
+        uint16_t words[2];
+        splitWords(raw, words);
+        for (uint8_t half = reg % 2; half < 2 && reg < end; half++, reg++) {
+            *values++ = words[half];
+        }
+    }
+}
+
+uint8_t RegisterMap::write(const RegisterEntry& entry, ModbusBlock& block) {
+    uint8_t first = entry.index + block.offset;
+
+    // Outputs are applied by processImage.task()
+    switch (entry.source) {
+        case SRC_RELAY: {
+            // All relays of one request go out as one command (one port write)
+            uint8_t mask = 0;
+            uint8_t states = 0;
+            for (uint16_t i = 0; i < block.count; i++) {
+                mask |= (1 << (first + i));
+                if (block.values[i] > 0) {
+                    states |= (1 << (first + i));
+                }
+            }
+            return image->queueRelays(mask, states) ? MB_EX_NONE : MB_EX_DEVICE_FAILURE;
+        }
+
+        case SRC_DAC_VOLTAGE:
+        case SRC_DAC_CURRENT: {
+            // Registers hold V or mA * scale, the queue takes mV or uA.
+            // Every value is checked before any channel is queued.
+            ProcessImageWrite type = (entry.source == SRC_DAC_CURRENT) ? PI_WRITE_DAC_CURRENT : PI_WRITE_DAC_VOLTAGE;
+            uint16_t values[2];
+            if (block.count > 2) {
+                return MB_EX_ILLEGAL_ADDRESS;
+            }
+            for (uint16_t i = 0; i < block.count; i++) {
+                uint32_t value = (uint32_t)block.values[i] * 1000 / entry.scale;
+                if (value > 0xFFFF) {
+                    return MB_EX_ILLEGAL_VALUE;
+                }
+                values[i] = value;
+            }
+            return image->queueDacs(first, block.count, type, values) ? MB_EX_NONE : MB_EX_DEVICE_FAILURE;
+        }
+
+        default:
+            return MB_EX_ILLEGAL_FUNCTION;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,172 @@
+/**
+ * RegisterMap.h - Modbus register map for Cortex Link A8R-M ESP32 IoT Smart Home Controller
+ *
+ * The whole map is one constexpr table. Every entry names a data table,
+ * an address range, the process image value it shows, its scaling and
+ * whether the bus may write it. The table is checked at compile time
+ * (no overlapping ranges, ranges inside the server's address space,
+ * writable entries only in writable tables) and RegisterMap::begin()
+ * registers one server handler per entry. A handler switches once on
+ * the entry's source, which the compiler turns into a jump table.
+ *
+ * 32-bit entries (int32 or float32) use two registers per value in the
+ * word order set by MB_WORD_LOW_FIRST. A handler reads each value once
+ * from one snapshot and splits it, so the two halves of a pair returned
+ * in one request always belong together.
+ */
+
+#ifndef REGISTER_MAP_H
+#define REGISTER_MAP_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "ModbusDefs.h"
+#include "ModbusComm.h"
+#include "ProcessImage.h"
+#include "I2CBus.h"
+
+// Process image value behind a register range
+enum RegSource {
+    SRC_INPUT,              // Digital input bit
+    SRC_RELAY,              // Relay state bit
+    SRC_VOLTAGE,            // 0-5V input in V
+    SRC_CURRENT,            // 4-20mA input in mA
+    SRC_DHT_TEMPERATURE,    // degC, 0xFFFF if the sensor is missing
+    SRC_DHT_HUMIDITY,       // %RH, 0xFFFF if the sensor is missing
+    SRC_DS18B20,            // degC, 0 if the sensor is missing
+    SRC_DAC_VOLTAGE,        // DAC output in V
+    SRC_DAC_CURRENT,        // DAC output in mA
+    SRC_BOARD_WINDOW,       // Packed board window, see MB_BOARD_*
+    SRC_DIAGNOSTICS,        // RS485 diagnostics, see MB_DIAG_*
+    SRC_I2C_STATS           // I2C bus and device statistics, see MB_I2C_*
+};
+
+// Register encoding of one value
+enum RegEncoding {
+    REG_U16,                // One register or bit, value * scale (16 bit)
+    REG_INT32,              // Two registers, value * scale as int32
+    REG_FLOAT32             // Two registers, IEEE 754 single (scale ignored)
+};
+
+enum RegAccess {
+    REG_READ,
+    REG_READ_WRITE
+};
+
+// One register range. With REG_U16 register i shows source element
+// index + i, as value * scale (signed values in two's complement). The
+// 32-bit encodings show element index + i / 2; count is in registers.
+struct RegisterEntry {
+    ModbusRegType type;
+    uint16_t address;
+    uint16_t count;
+    RegSource source;
+    uint8_t index;
+    uint16_t scale;
+    RegEncoding encoding;
+    RegAccess access;
+};
+
+constexpr RegisterEntry registerMap[] = {
+    { MB_COIL,           MB_COIL_RELAYS_START,                      NUM_RELAY_OUTPUTS,        SRC_RELAY,           0, 1,    REG_U16,     REG_READ_WRITE },
+    { MB_DISCRETE_INPUT, MB_DISCRETE_INPUTS_START,                  NUM_DIGITAL_INPUTS,       SRC_INPUT,           0, 1,    REG_U16,     REG_READ },
+    { MB_INPUT_REG,      MB_REG_INPUTS_START,                       NUM_DIGITAL_INPUTS,       SRC_INPUT,           0, 1,    REG_U16,     REG_READ },
+    { MB_HOLDING_REG,    MB_REG_RELAYS_START,                       NUM_RELAY_OUTPUTS,        SRC_RELAY,           0, 1,    REG_U16,     REG_READ_WRITE },
+    { MB_INPUT_REG,      MB_REG_ANALOG_START,                       NUM_ANALOG_CHANNELS,      SRC_VOLTAGE,         0, 1000, REG_U16,     REG_READ },
+    { MB_INPUT_REG,      MB_REG_ANALOG_START + NUM_ANALOG_CHANNELS, NUM_CURRENT_CHANNELS,     SRC_CURRENT,         0, 1000, REG_U16,     REG_READ },
+    { MB_INPUT_REG,      MB_REG_TEMP_START,                         NUM_DHT_SENSORS,          SRC_DHT_TEMPERATURE, 0, 10,   REG_U16,     REG_READ },
+    { MB_INPUT_REG,      MB_REG_HUM_START,                          NUM_DHT_SENSORS,          SRC_DHT_HUMIDITY,    0, 10,   REG_U16,     REG_READ },
+    { MB_INPUT_REG,      MB_REG_DS18B20_START,                      MAX_DS18B20_SENSORS,      SRC_DS18B20,         0, 10,   REG_U16,     REG_READ },
+    { MB_HOLDING_REG,    MB_REG_DAC_START,                          1,                        SRC_DAC_VOLTAGE,     0, 1000, REG_U16,     REG_READ_WRITE },
+    { MB_HOLDING_REG,    MB_REG_DAC_START + 1,                      1,                        SRC_DAC_CURRENT,     0, 1000, REG_U16,     REG_READ_WRITE },
+    { MB_HOLDING_REG,    MB_REG_DAC_START + 2,                      1,                        SRC_DAC_VOLTAGE,     1, 1000, REG_U16,     REG_READ_WRITE },
+    { MB_HOLDING_REG,    MB_REG_DAC_START + 3,                      1,                        SRC_DAC_CURRENT,     1, 1000, REG_U16,     REG_READ_WRITE },
+    { MB_INPUT_REG,      MB_REG_BOARD_START,                        MB_BOARD_WINDOW_SIZE,     SRC_BOARD_WINDOW,    0, 1,    REG_U16,     REG_READ },
+    { MB_INPUT_REG,      MB_REG_DIAG_START,                         MB_DIAG_WINDOW_SIZE,      SRC_DIAGNOSTICS,     0, 1,    REG_U16,     REG_READ },
+    { MB_INPUT_REG,      MB_REG_I2C_START,                          MB_I2C_WINDOW_SIZE,       SRC_I2C_STATS,       0, 1,    REG_U16,     REG_READ },
+#ifdef MB_32BIT_VIEWS
+    { MB_INPUT_REG,      MB_REG_FLOAT_START + MB_VIEW_VOLTAGE,      2 * NUM_ANALOG_CHANNELS,  SRC_VOLTAGE,         0, 1,    REG_FLOAT32, REG_READ },
+    { MB_INPUT_REG,      MB_REG_FLOAT_START + MB_VIEW_CURRENT,      2 * NUM_CURRENT_CHANNELS, SRC_CURRENT,         0, 1,    REG_FLOAT32, REG_READ },
+    { MB_INPUT_REG,      MB_REG_FLOAT_START + MB_VIEW_TEMP,         2 * NUM_DHT_SENSORS,      SRC_DHT_TEMPERATURE, 0, 1,    REG_FLOAT32, REG_READ },
+    { MB_INPUT_REG,      MB_REG_FLOAT_START + MB_VIEW_HUM,          2 * NUM_DHT_SENSORS,      SRC_DHT_HUMIDITY,    0, 1,    REG_FLOAT32, REG_READ },
+    { MB_INPUT_REG,      MB_REG_FLOAT_START + MB_VIEW_DS18B20,      2 * MAX_DS18B20_SENSORS,  SRC_DS18B20,         0, 1,    REG_FLOAT32, REG_READ },
+    { MB_INPUT_REG,      MB_REG_FLOAT_START + MB_VIEW_DAC_VOLTAGE,  2 * 2,                    SRC_DAC_VOLTAGE,     0, 1,    REG_FLOAT32, REG_READ },
+    { MB_INPUT_REG,      MB_REG_FLOAT_START + MB_VIEW_DAC_CURRENT,  2 * 2,                    SRC_DAC_CURRENT,     0, 1,    REG_FLOAT32, REG_READ },
+    { MB_INPUT_REG,      MB_REG_INT32_START + MB_VIEW_VOLTAGE,      2 * NUM_ANALOG_CHANNELS,  SRC_VOLTAGE,         0, 1000, REG_INT32,   REG_READ },
+    { MB_INPUT_REG,      MB_REG_INT32_START + MB_VIEW_CURRENT,      2 * NUM_CURRENT_CHANNELS, SRC_CURRENT,         0, 1000, REG_INT32,   REG_READ },
+    { MB_INPUT_REG,      MB_REG_INT32_START + MB_VIEW_TEMP,         2 * NUM_DHT_SENSORS,      SRC_DHT_TEMPERATURE, 0, 1000, REG_INT32,   REG_READ },
+    { MB_INPUT_REG,      MB_REG_INT32_START + MB_VIEW_HUM,          2 * NUM_DHT_SENSORS,      SRC_DHT_HUMIDITY,    0, 1000, REG_INT32,   REG_READ },
+    { MB_INPUT_REG,      MB_REG_INT32_START + MB_VIEW_DS18B20,      2 * MAX_DS18B20_SENSORS,  SRC_DS18B20,         0, 1000, REG_INT32,   REG_READ },
+    { MB_INPUT_REG,      MB_REG_INT32_START + MB_VIEW_DAC_VOLTAGE,  2 * 2,                    SRC_DAC_VOLTAGE,     0, 1000, REG_INT32,   REG_READ },
+    { MB_INPUT_REG,      MB_REG_INT32_START + MB_VIEW_DAC_CURRENT,  2 * 2,                    SRC_DAC_CURRENT,     0, 1000, REG_INT32,   REG_READ },
+#endif
+};
+
+constexpr uint8_t REGISTER_MAP_SIZE = sizeof(registerMap) / sizeof(registerMap[0]);
+
+// Compile-time checks (C++11 constexpr, so recursion instead of loops)
+namespace RegisterMapCheck {
+    constexpr bool overlaps(const RegisterEntry& a, const RegisterEntry& b) {
+        return a.type == b.type && a.address < b.address + b.count && b.address < a.address + a.count;
+    }
+
+    constexpr bool disjointFrom(uint8_t i, uint8_t j) {
+        return j >= REGISTER_MAP_SIZE ||
+               (!overlaps(registerMap[i], registerMap[j]) && disjointFrom(i, j + 1));
+    }
+
+    constexpr bool disjoint(uint8_t i) {
+        return i >= REGISTER_MAP_SIZE || (disjointFrom(i, i + 1) && disjoint(i + 1));
+    }
+
+    constexpr uint16_t spaceOf(ModbusRegType type) {
+        return (type == MB_COIL || type == MB_DISCRETE_INPUT) ? MB_SERVER_BIT_SPACE : MB_SERVER_REG_SPACE;
+    }
+
+    constexpr bool valid(uint8_t i) {
+        return i >= REGISTER_MAP_SIZE ||
+               (registerMap[i].count > 0 &&
+                (registerMap[i].encoding == REG_U16 || registerMap[i].count % 2 == 0) &&
+                registerMap[i].address + registerMap[i].count <= spaceOf(registerMap[i].type) &&
+                (registerMap[i].access == REG_READ ||
+                 registerMap[i].type == MB_HOLDING_REG || registerMap[i].type == MB_COIL) &&
+                valid(i + 1));
+    }
+}
+
+static_assert(RegisterMapCheck::disjoint(0), "Register map ranges overlap");
+static_assert(RegisterMapCheck::valid(0), "Register map entry outside the server space, writable in a read-only table or splitting a 32-bit pair");
+static_assert(REGISTER_MAP_SIZE <= MB_SERVER_MAX_HANDLERS, "More register map entries than server handler slots");
+
+class RegisterMap {
+public:
+    RegisterMap();
+
+    /**
+     * Register a server handler for every map entry
+     * @param comm Modbus port whose server core gets the handlers
+     * @param image Process image the registers are served from
+     * @param bus I2C bus whose statistics are served
+     * @return false if the server refused an entry
+     */
+    bool begin(ModbusComm& comm, ProcessImage& image, I2CBus& bus);
+
+private:
+    // Context of one entry's handler
+    struct EntryBinding {
+        RegisterMap* map;
+        const RegisterEntry* entry;
+    };
+
+    ModbusComm* comm;
+    ProcessImage* image;
+    I2CBus* bus;
+    EntryBinding bindings[REGISTER_MAP_SIZE];
+
+    static uint8_t handleEntry(void* context, ModbusBlock& block);
+    uint8_t handle(const RegisterEntry& entry, ModbusBlock& block);
+    void readWide(const RegisterEntry& entry, ModbusBlock& block, const ProcessImageData& data);
+    uint8_t write(const RegisterEntry& entry, ModbusBlock& block);
+};
+
+#endif // REGISTER_MAP_H
\ No newline at end of file
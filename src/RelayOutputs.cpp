@@ -1,68 +1,178 @@
-#include "RelayOutputs.h"
-
-RelayOutputs::RelayOutputs() : relayStates(0) {
-}
-
-bool RelayOutputs::begin() {
-    // Initialize MCP23017 for relay outputs
-    mcp.begin(MCP23017_OUTPUT_ADDR);
-    
-    // Configure GPA0-GPA5 as outputs for the 6 relays
-    for (uint8_t pin = 0; pin < NUM_RELAY_OUTPUTS; pin++) {
-        mcp.pinMode(pin, OUTPUT);
-        mcp.digitalWrite(pin, HIGH);  // Initialize all relays to OFF
-    }
-    
-    relayStates = 0;
-    return true;
-}
-
-bool RelayOutputs::setRelay(uint8_t relayNum, bool state) {
-    if (relayNum >= NUM_RELAY_OUTPUTS) {
-        return false;
-    }
-    
-    // Set relay state
-    mcp.digitalWrite(relayNum, state ? HIGH : LOW);
-    
-    // Update relay states
-    if (state) {
-        relayStates |= (1 << relayNum);
-    } else {
-        relayStates &= ~(1 << relayNum);
-    }
-    
-    return true;
-}
-
-bool RelayOutputs::toggleRelay(uint8_t relayNum) {
-    if (relayNum >= NUM_RELAY_OUTPUTS) {
-        return false;
-    }
-    
-    bool currentState = getRelayState(relayNum);
-    return setRelay(relayNum, !currentState);
-}
-
-bool RelayOutputs::getRelayState(uint8_t relayNum) {
-    if (relayNum >= NUM_RELAY_OUTPUTS) {
-        return false;
-    }
-    
-    return (relayStates & (1 << relayNum)) != 0;
-}
-
-uint8_t RelayOutputs::getAllRelayStates() {
-    return relayStates;
-}
-
-void RelayOutputs::setAllRelays(uint8_t states) {
-    // Set all relays according to the bit pattern in 'states'
-    for (uint8_t i = 0; i < NUM_RELAY_OUTPUTS; i++) {
-        bool state = (states & (1 << i)) != 0;
-        mcp.digitalWrite(i, state ? HIGH : LOW);
-    }
-    
-    // Update relay states
-    relayStates = states & ((1 << NUM_RELAY_OUTPUTS) - 1);  // Mask to valid relays only
-}
\ No newline at end of file
+#include "RelayOutputs.h"
+
+#define RELAY_MASK  ((1 << NUM_RELAY_OUTPUTS) - 1)
+
+RelayOutputs::RelayOutputs() :
+    mcp(MCP23017_OUTPUT_ADDR),
+    bus(nullptr),
+    relayStates(0),
+    pendingOn(0),
+    dirty(0),
+    inrushGapMs(RELAY_INRUSH_GAP_MS),
+    staggering(false),
+    staggerTimer(nullptr)
+{
+    staggerWrite.address = MCP23017_OUTPUT_ADDR;
+    staggerWrite.job = runLatchWrite;
+    staggerWrite.context = this;
+    staggerWrite.priority = I2C_PRIO_HIGH;
+}
+
+bool RelayOutputs::begin(I2CBus& i2c) {
+    bus = &i2c;
+    uint8_t relayPins = RELAY_MASK;
+
+    // Configure GPA0-GPA5 as outputs for the 6 relays, latched HIGH before
+    // they become outputs (initialize all relays to OFF)
+    MCP23017Config config = {};
+    config.iodir = 0xFFFF & ~relayPins;
+    config.olat = relayPins;
+
+    // One-shot timer that switches the next waiting relay on
+    if (staggerTimer == nullptr) {
+        esp_timer_create_args_t timerArgs = {};
+        timerArgs.callback = onStaggerTimer;
+        timerArgs.arg = this;
+        timerArgs.dispatch_method = ESP_TIMER_TASK;
+        timerArgs.name = "relays";
+        if (esp_timer_create(&timerArgs, &staggerTimer) != ESP_OK) {
+            staggerTimer = nullptr;
+        }
+    }
+
+    relayStates = 0;
+    return mcp.begin(*bus, config);
+}
+
+bool RelayOutputs::setRelay(uint8_t relayNum, bool state) {
+    if (relayNum >= NUM_RELAY_OUTPUTS) {
+        return false;
+    }
+    
+    // Whole-port write from the cached states, no read-modify-write
+    return setRelays(1 << relayNum, state ? (1 << relayNum) : 0);
+}
+
+bool RelayOutputs::toggleRelay(uint8_t relayNum) {
+    if (relayNum >= NUM_RELAY_OUTPUTS) {
+        return false;
+    }
+    
+    bool currentState = getRelayState(relayNum);
+    return setRelay(relayNum, !currentState);
+}
+
+bool RelayOutputs::getRelayState(uint8_t relayNum) {
+    if (relayNum >= NUM_RELAY_OUTPUTS) {
+        return false;
+    }
+    
+    return (relayStates & (1 << relayNum)) != 0;
+}
+
+uint8_t RelayOutputs::getAllRelayStates() {
+    return relayStates;
+}
+
+void RelayOutputs::setAllRelays(uint8_t states) {
+    // Set all relays according to the bit pattern in 'states'
+    setRelays(0xFF, states);
+}
+
+bool RelayOutputs::setRelays(uint8_t mask, uint8_t states) {
+    mask &= RELAY_MASK;  // Mask to valid relays only
+    if (mask == 0) {
+        return false;
+    }
+
+    bool startTimer = false;
+
+    portENTER_CRITICAL(&lock);
+    uint8_t turningOn = mask & states & ~relayStates;
+    relayStates = (relayStates & ~mask) | (states & mask);
+    pendingOn &= relayStates;        // Relays switched off again stop waiting
+    dirty |= mask;
+
+    if (turningOn != 0 && inrushGapMs > 0 && staggerTimer != nullptr) {
+        if (staggering) {
+            // The running timer takes them in turn
+            pendingOn |= turningOn;
+        }
+        else {
+            // Lowest relay now, the rest one gap apart
+            uint8_t first = turningOn & -turningOn;
+            pendingOn |= turningOn & ~first;
+            staggering = true;
+            startTimer = true;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if (startTimer) {
+        esp_timer_start_once(staggerTimer, (uint64_t)inrushGapMs * 1000);
+    }
+
+    // The latch is computed on the bus task, so this write and the
+    // timer's writes go out in order and never undo each other
+    return bus->run(runLatchWrite, this, I2C_PRIO_HIGH, MCP23017_OUTPUT_ADDR);
+}
+
+void RelayOutputs::onStaggerTimer(void* arg) {
+    RelayOutputs* relays = static_cast<RelayOutputs*>(arg);
+    uint8_t next = 0;
+    bool unwritten;
+
+    portENTER_CRITICAL(&relays->lock);
+    if (relays->pendingOn != 0) {
+        next = relays->pendingOn & -relays->pendingOn;
+        relays->pendingOn &= ~next;
+        relays->dirty |= next;
+    }
+    // Bits set while a write was already running, or left by a failed one
+    unwritten = (relays->dirty != 0);
+    if (next == 0 && !unwritten) {
+        // A gap has passed since the last relay switched on
+        relays->staggering = false;
+    }
+    portEXIT_CRITICAL(&relays->lock);
+
+    if (next == 0 && !unwritten) {
+        return;
+    }
+
+    // Keep the timer running until every latch bit is written
+    esp_timer_start_once(relays->staggerTimer, (uint64_t)relays->inrushGapMs * 1000);
+
+    // Never block the timer task: queue the write. One still waiting
+    // picks up this relay when it runs, anything it misses is queued
+    // on the next tick.
+    if (relays->staggerWrite.result != I2C_RESULT_PENDING) {
+        relays->bus->submit(relays->staggerWrite);
+    }
+}
+
+bool RelayOutputs::runLatchWrite(TwoWire& wire, void* context) {
+    RelayOutputs* relays = static_cast<RelayOutputs*>(context);
+
+    portENTER_CRITICAL(&relays->lock);
+    uint8_t mask = relays->dirty;
+    uint8_t latch = relays->relayStates & ~relays->pendingOn;
+    relays->dirty = 0;
+    portEXIT_CRITICAL(&relays->lock);
+
+    if (mask == 0) {
+        return true;
+    }
+
+    // All relays sit on GPA0-GPA5, so one port write switches them together.
+    // GPA6/GPA7 are inputs and ignore the output latch.
+    if (relays->mcp.writePins(MCP_PORT_A, mask, latch, I2C_PRIO_HIGH)) {
+        return true;
+    }
+
+    // Written again on the next stagger tick or with the next command
+    portENTER_CRITICAL(&relays->lock);
+    relays->dirty |= mask;
+    portEXIT_CRITICAL(&relays->lock);
+    return false;
+}
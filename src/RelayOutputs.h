@@ -1,23 +1,57 @@
-#ifndef RELAY_OUTPUTS_H
-#define RELAY_OUTPUTS_H
-
-#include <Arduino.h>
-#include <MCP23017.h>
-#include "Config.h"
-
-class RelayOutputs {
-public:
-    RelayOutputs();
-    bool begin();
-    bool setRelay(uint8_t relayNum, bool state);
-    bool toggleRelay(uint8_t relayNum);
-    bool getRelayState(uint8_t relayNum);
-    uint8_t getAllRelayStates();
-    void setAllRelays(uint8_t states);
-
-private:
-    MCP23017 mcp;
-    uint8_t relayStates;
-};
-
+#ifndef RELAY_OUTPUTS_H
+#define RELAY_OUTPUTS_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "Config.h"
+#include "MCP23017Driver.h"
+
+class RelayOutputs {
+public:
+    RelayOutputs();
+    bool begin(I2CBus& bus);
+    bool setRelay(uint8_t relayNum, bool state);
+    bool toggleRelay(uint8_t relayNum);
+    bool getRelayState(uint8_t relayNum);
+    uint8_t getAllRelayStates();
+    void setAllRelays(uint8_t states);
+
+    /**
+     * Switch several relays in one command: relays turned off and the
+     * first one turned on go out in one OLAT write. With an inrush gap,
+     * every further relay turned on follows one gap after the previous
+     * one, timed by esp_timer.
+     * @param mask Relays to change (bit n = relay n)
+     * @param states New states of the relays in mask
+     * @return false if the mask holds no valid relay or the write failed
+     */
+    bool setRelays(uint8_t mask, uint8_t states);
+
+    /**
+     * Gap between two relays switching on, 0 switches them at once
+     */
+    void setInrushGap(uint16_t ms) { inrushGapMs = ms; }
+    uint16_t getInrushGap() const { return inrushGapMs; }
+
+    /**
+     * Relays commanded on that wait for their turn
+     */
+    uint8_t getPendingRelays() const { return pendingOn; }
+
+private:
+    MCP23017Driver mcp;
+    I2CBus* bus;
+    uint8_t relayStates;             // Commanded states
+    uint8_t pendingOn;               // Commanded on, not switched yet
+    uint8_t dirty;                   // Relays whose latch bit needs writing
+    uint16_t inrushGapMs;
+    bool staggering;                 // A relay switched on less than a gap ago
+    esp_timer_handle_t staggerTimer;
+    I2CTransaction staggerWrite;     // Latch write submitted by the timer
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    static void onStaggerTimer(void* arg);
+    static bool runLatchWrite(TwoWire& wire, void* context);
+};
+
 #endif // RELAY_OUTPUTS_H
\ No newline at end of file